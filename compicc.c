@@ -17,8 +17,14 @@
 /* strdup needs _BSD_SOURCE */
 #define _BSD_SOURCE
 #include <assert.h>
+#include <dirent.h>
+#include <errno.h>
 #include <math.h>     // floor()
 #include <string.h>   // http://www.opengroup.org/onlinepubs/009695399/functions/strdup.html
+#include <pthread.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <time.h>
 #include <unistd.h>   // getpid()
@@ -53,13 +59,20 @@
 
 
 #define OY_COMPIZ_VERSION (COMPIZ_VERSION_MAJOR * 10000 + COMPIZ_VERSION_MINOR * 100 + COMPIZ_VERSION_MICRO)
+/* compiz logging is for the compositor thread; workers use workerLogMessage() */
 #if OY_COMPIZ_VERSION < 708
 #define oyCompLogMessage(disp_, plug_in_name, debug_level, format_, ... ) \
-        compLogMessage( disp_, plug_in_name, debug_level, format_, __VA_ARGS__ )
+{ if(!pthread_equal( pthread_self(), compositor_thread )) \
+    workerLogMessage( plug_in_name, debug_level, format_, __VA_ARGS__ ); \
+  else \
+    compLogMessage( disp_, plug_in_name, debug_level, format_, __VA_ARGS__ ); \
+}
 #else
 #define oyCompLogMessage( disp_, plug_in_name, debug_level, format_, ... ) \
 { if(oy_debug) \
     oyMessageFunc_p( oyMSG_DBG, NULL, format_, __VA_ARGS__); \
+  else if(!pthread_equal( pthread_self(), compositor_thread )) \
+    workerLogMessage( plug_in_name, debug_level, format_, __VA_ARGS__ ); \
   else \
     compLogMessage( plug_in_name, debug_level, format_, __VA_ARGS__ ); \
 }
@@ -83,6 +96,26 @@
  * That means each active region will use 1.5MiB of texture memory.
  */
 #define GRIDPOINTS 64
+#define CLUT_SIZE (sizeof(GLushort) * GRIDPOINTS*GRIDPOINTS*GRIDPOINTS * 3)
+
+/**
+ * Finished CLUTs are uploaded in pluginPreparePaintScreen(). Each frame
+ * uploads at least one CLUT and then continues as long as it stays below
+ * UPLOAD_BUDGET_BYTES and UPLOAD_BUDGET_USEC. pluginDonePaintScreen() asks
+ * for the next frame, while CLUTs are left in the queue.
+ */
+#define UPLOAD_BUDGET_BYTES (2 * CLUT_SIZE)
+#define UPLOAD_BUDGET_USEC  4000
+
+/* needUpdate() */
+#define UPDATE_NONE      0
+#define UPDATE_GEOMETRY  1
+#define UPDATE_DEVICES   2
+
+/* PrivScreen::setupStep */
+#define SETUP_IDLE    -1
+#define SETUP_DEVICES  0
+#define SETUP_OUTPUTS  1
 
 static signed long colour_desktop_region_count = -1;
 /**
@@ -103,7 +136,16 @@ static signed long colour_desktop_region_count = -1;
 #define DBG
 #endif
 
-static int icc_profile_flags = 0;
+/* -1 until Oyranos is initialised, see iccProfileFlags(); atomic */
+static int icc_profile_flags = -1;
+static pthread_mutex_t icc_profile_flags_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Oyranos calls, which read the DB, load modules or create profiles, are not
+ * known to be thread safe. They run one at a time from any thread: device
+ * queries, profile creation, DB reloads and filter graph setup. Only pixel
+ * conversions on job owned graphs run in parallel. iccProfileFlags() locks
+ * it by itself and is never called with it held. */
+static pthread_mutex_t oy_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 #define DBG_STRING " %s:%d %s() %.02f "
 #define DBG_ARGS (strrchr(__FILE__,'/') ? strrchr(__FILE__,'/')+1 : __FILE__),__LINE__,__func__,(double)clock()/CLOCKS_PER_SEC
@@ -120,6 +162,9 @@ extern "C" {
 #endif /* __cplusplus */
 void* oyAllocateFunc_           (size_t        size);
 void  oyDeAllocateFunc_         (void *        data);
+int   oyMiscBlobGetMD5_         (void *        buffer,
+                                 size_t        size,
+                                 unsigned char * md5_return);
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
@@ -128,29 +173,92 @@ void  oyDeAllocateFunc_         (void *        data);
 void* cicc_alloc                (size_t        size) { void * p = oyAllocateFunc_(size); memset(p,0,size); return p; }
 void  cicc_free                 (void *        data) { oyDeAllocateFunc_(data); }
 
+/* the thread, which runs compiz; set in pluginInit() */
+static pthread_t compositor_thread;
+
+/**
+ * Log from a worker thread without going through compiz, whose log hooks
+ * belong to the compositor thread. Debug and info messages are dropped.
+ */
+static void workerLogMessage( const char * name, CompLogLevel level,
+                              const char * format, ... )
+{
+  char text[1024];
+  va_list args;
+
+  if(level > CompLogLevelWarn)
+    return;
+
+  va_start( args, format );
+  vsnprintf( text, sizeof(text), format, args );
+  va_end( args );
+  fprintf( stderr, "%s (worker): %s\n", name, text );
+}
+
 typedef CompBool (*dispatchObjectProc) (CompPlugin *plugin, CompObject *object, void *privateData);
 
 /** Be active once and then not again. */
 static int colour_desktop_can = 1;
 
-/* last check time */
+/* start of the colour service, as written into _ICC_COLOR_DESKTOP */
 static time_t icc_color_desktop_last_time = 0;
 
+typedef struct PrivJob PrivJob;
+typedef struct PrivCacheEntry PrivCacheEntry;
+
+/**
+ *  The per frame part of a colour context. Region contexts keep it inline,
+ *  output contexts in the dense PrivScreen::draw array.
+ */
+typedef struct {
+  GLuint glTexture;                  /* texture reference */
+  GLfloat scale, offset;             /* texture parameters */
+} PrivColorTexture;
+
 /**
  *  All data to create and use a color conversion.
  *  Included are OpenGL texture, the source ICC profile for reference and the
  *  target profile for the used monitor.
+ *  Workers build into a copy of the context. The result is taken over only,
+ *  when the generation did not change meanwhile.
+ *  A CLUT lives in the cache after it was built. The context only points to
+ *  the entry and reads it again for each upload. An own clut is kept only,
+ *  when the cache could not take it.
  */
 typedef struct {
+  PrivColorTexture * texture;        /* region_texture or in PrivScreen::draw */
   oyProfile_s * src_profile;         /* the data profile or device link */
   oyProfile_s * dst_profile;         /* the monitor profile or none */
   char * output_name;                /* the intented output device */
-  GLushort clut[GRIDPOINTS][GRIDPOINTS][GRIDPOINTS][3]; /* lookup table */
-  GLuint glTexture;                  /* texture reference */
-  GLfloat scale, offset;             /* texture parameters */
+  GLushort (*clut)[GRIDPOINTS][GRIDPOINTS][3]; /* own lookup table or NULL */
+  PrivCacheEntry * cache;            /* shared lookup table, referenced, or NULL */
   int ref;                           /* reference counter */
+  uint8_t transform_md5[16];         /* identifies the transform, zero = none */
+  int upload_pending;                /* clut waits for cdCreateTexture() */
+  int output;                        /* index of the output */
+  Window window;                     /* window of a region context or None */
+  PrivJob * job;                     /* CLUT build in flight or NULL */
+  unsigned int generation;           /* bumped, when a job result is stale */
+  PrivColorTexture region_texture;   /* unused by outputs */
 } PrivColorContext;
 
+/**
+ * Colour regions are mostly made of one to four rectangles. A PrivRegion keeps
+ * up to PRIV_REGION_BOXES boxes inline and moves to heap memory only beyond
+ * that. The boxes never overlap. The extents are the bounding box; an empty
+ * region has all zero extents, like a Xlib Region.
+ */
+#define PRIV_REGION_BOXES 4
+typedef struct {
+  int nBoxes;                        /* used boxes */
+  int reserved;                      /* allocated boxes in heap */
+  BOX * heap;                        /* used instead of boxes, when set */
+  BOX boxes[PRIV_REGION_BOXES];      /* inline storage */
+  BOX extents;                       /* bounding box */
+} PrivRegion;
+
+#define REGION_BOXES(r) ((r)->heap ? (r)->heap : (r)->boxes)
+
 /**
  * The XserverRegion is dereferenced when the client sets it on a window.
  * This allows clients to change the region as the window is resized.
@@ -163,21 +271,79 @@ typedef struct {
   /* These members are only valid when this region is part of the
    * active stack range. */
   uint8_t md5[16];
+  XserverRegion id;                  /* the clients region */
   PrivColorContext ** cc;
-  Region xRegion;
+  unsigned long nCc;                 /* outputs, for which cc was created */
+  PrivRegion region;
 } PrivColorRegion;
 
 /**
  * Output profiles are currently only fetched using XRandR. For backwards 
  * compatibility the code should fall back to root window properties 
  * (XCM_ICC_V0_3_TARGET_PROFILE_IN_X_BASE).
+ * What the draw loops read per frame, is kept apart in PrivOutputDraw.
  */
+typedef struct {
+  XRectangle xRect;
+  PrivColorTexture texture;
+} PrivOutputDraw;
+
 typedef struct {
   char name[32];
   PrivColorContext cc;
-  XRectangle xRect;
+  PrivOutputDraw * draw;             /* the outputs entry in PrivScreen::draw */
+  uint8_t id[16];                    /* monitor identity, see deviceId() */
+  int identified;                    /* id is valid */
+  int keep;                          /* taken over by adoptOutputs():
+                                        1 - same index, 2 - moved */
+  int movePending;                   /* profile atoms move after the jobs */
 } PrivColorOutput;
 
+/**
+ * ICC profiles in root window properties can be several MiB in size. They are
+ * read in chunks of ICC_PROPERTY_CHUNK_SIZE into a buffer, which is kept
+ * around for the next request, unless it grew above ICC_PROPERTY_KEEP_SIZE.
+ * Properties larger than ICC_PROPERTY_MAX_SIZE are ignored.
+ */
+#define ICC_PROPERTY_CHUNK_SIZE (64 * 1024)
+#define ICC_PROPERTY_KEEP_SIZE  (1024 * 1024)
+#define ICC_PROPERTY_MAX_SIZE   (32 * 1024 * 1024)
+#define ICC_PROPERTY_RETRIES    3
+
+typedef struct {
+  unsigned char * data;              /* reusable storage */
+  unsigned long size;                /* valid bytes in data */
+  unsigned long reserved;            /* allocated bytes in data */
+  uint8_t md5[16];                   /* hash over the valid bytes */
+} PrivPropertyBuffer;
+
+
+/**
+ * A token bucket limits how often a client can trigger expensive updates
+ * through a property. Each update takes one token. Tokens are refilled with
+ * RATE_LIMIT_RATE per second up to RATE_LIMIT_BURST. Updates finding no
+ * token are folded into one deferred update.
+ */
+#define RATE_LIMIT_BURST 8
+#define RATE_LIMIT_RATE  10          /* updates per second */
+
+typedef struct {
+  double tokens;
+  struct timeval last;               /* last refill */
+  CompTimeoutHandle deferred;        /* pending folded update or 0 */
+  unsigned long folded;              /* updates folded into the deferred one */
+  int reported;                      /* the first deferral was logged */
+} PrivRateLimit;
+
+
+/**
+ * Output rectangles, whose colour transform or geometry changed.
+ */
+typedef struct {
+  int n;
+  XRectangle * rects;
+} PrivDamageOutputs;
+
 
 static CompMetadata pluginMetadata;
 
@@ -204,12 +370,25 @@ typedef struct {
   Atom iccColorDesktop;
   Atom netDesktopGeometry;
   Atom iccDisplayAdvanced;
+  Atom manager;
+
+  /* _ICC_COLOR_DESKTOP_S<screen> manager selections */
+  Atom * colorDesktopSelections;
+  int nColorDesktopSelections;
+
+  /* reused for reading profile properties */
+  PrivPropertyBuffer profileBuffer;
+
+  /* focus, which the queued colour work is ranked for */
+  Window activeWindow;
 } PrivDisplay;
 
 typedef struct {
   int childPrivateIndex;
 
   /* hooked functions */
+  PreparePaintScreenProc preparePaintScreen;
+  DonePaintScreenProc donePaintScreen;
   DrawWindowProc drawWindow;
   DrawWindowTextureProc drawWindowTexture;
 
@@ -217,9 +396,48 @@ typedef struct {
   int function, param, unit;
   int function_2, param_2, unit_2;
 
-  /* XRandR outputs and the associated profiles */
+  /* XRandR outputs and the associated profiles; draw holds the per frame
+   * data of each output densely */
   unsigned long nContexts;
+  PrivOutputDraw *draw;
   PrivColorOutput *contexts;
+
+  /* outputs of the previous configuration until setupOutputStep() matched
+   * them against the new devices */
+  unsigned long nOldContexts;
+  PrivColorOutput *oldContexts;
+  PrivOutputDraw *oldDraw;
+
+  /* per output _ICC_PROFILE(_xxx) and _ICC_DEVICE_PROFILE(_xxx) atoms */
+  Atom *profileAtoms;
+  Atom *deviceProfileAtoms;
+
+  /* _ICC_COLOR_PROFILES updates */
+  PrivRateLimit profilesLimit;
+
+  /* output setup state machine, see setupOutputStep() */
+  CompTimeoutHandle setupTimeout;
+  int setupStep;
+  oyConfigs_s *setupDevices;
+  struct timeval setupStart;         /* for the startup time, zero when reported */
+
+  /* _ICC_COLOR_DESKTOP_S<screen> manager selection and its owner window */
+  Atom colorDesktopSelection;
+  Window selectionWindow;
+  GLint stencilBits;
+
+  /* Oyranos initialisation in a worker */
+  PrivJob * warmUp;
+
+  /* contexts waiting for a texture upload */
+  PrivColorContext **uploads;
+  int nUploads;
+  int reservedUploads;
+
+  /* jobs in the worker pool; output jobs move the profile atoms together */
+  int nJobs;
+  int nOutputJobs;
+  int saveResolved;
 } PrivScreen;
 
 typedef struct {
@@ -234,6 +452,12 @@ typedef struct {
   /* old absolute region */
   oyRectangle_s * absoluteWindowRectangleOld;
 
+  /* hash over the last applied _ICC_COLOR_REGIONS, XFixes regions and size */
+  uint8_t regions_md5[16];
+
+  /* _ICC_COLOR_REGIONS updates */
+  PrivRateLimit regionsLimit;
+
   /* active stack range */
   unsigned long active;
 
@@ -241,8 +465,9 @@ typedef struct {
   char *output;
 } PrivWindow;
 
-static Region absoluteRegion(CompWindow *w, Region region);
+static void absoluteRegion(CompWindow *w, const PrivRegion *region, PrivRegion *abs);
 static void damageWindow(CompWindow *w, void *closure);
+static void damageWindowOutputs(CompWindow *w, void *closure);
 static void addWindowRegionCount(CompWindow *w, void * count);
 oyPointer  pluginGetPrivatePointer   ( CompObject        * o );
 static void updateOutputConfiguration( CompScreen        * s,
@@ -251,13 +476,14 @@ static void updateOutputConfiguration( CompScreen        * s,
 static int updateIccColorDesktopAtom ( CompScreen        * s,
                                        PrivScreen        * ps,
                                        int                 request );
-static oyPointer   getScreenProfile  ( CompScreen        * s,
+static oyProfile_s * getScreenProfile( CompScreen        * s,
                                        int                 screen,
                                        int                 server,
                                        size_t            * size );
 int            needUpdate            ( Display           * display );
 static void    moveICCprofileAtoms   ( CompScreen        * s,
-                                       int                 screen,
+                                       const int         * screens,
+                                       int                 n,
                                        int                 init );
 void           cleanDisplayProfiles  ( CompScreen        * s );
 static int     getDisplayAdvanced    ( CompScreen        * s,
@@ -267,19 +493,39 @@ static int     getDeviceProfile      ( CompScreen        * s,
                                        oyConfig_s        * device,
                                        int                 screen );
 oyProfile_s *  profileFromMD5        ( uint8_t           * md5 );
-static void    setupOutputTable      ( CompScreen        * s,
+static int     askDeviceProfile      ( const char        * name,
+                                       const uint8_t     * id,
                                        oyConfig_s        * device,
+                                       oyProfile_s      ** profile );
+static void    setupOutputTable      ( CompScreen        * s,
                                        int                 screen );
-static void    setupColourTable      ( PrivColorContext  * ccontext,
+static oyProfile_s * lookupResolvedProfile( const uint8_t   id[16] );
+static void    storeResolvedProfile  ( const uint8_t       id[16],
+                                       oyProfile_s       * profile );
+static void    saveResolvedProfiles  ( void );
+static int     setupColourTable      ( PrivColorContext  * ccontext,
                                        int                 advanced,
-                                       CompScreen        * s );
+                                       const int         * cancel );
+static PrivJob * newJob              ( CompScreen        * s,
+                                       PrivColorContext  * ccontext,
+                                       void             (* run)( PrivJob * ),
+                                       void             (* done)( PrivJob * ) );
+static void    submitJob             ( PrivJob           * job );
+static void    cancelJob             ( PrivJob           * job );
+static void    startOutputSetup      ( CompScreen        * s );
+static void    cancelOutputSetup     ( PrivScreen        * ps );
+static void    releaseOutputTextures ( CompScreen        * s,
+                                       PrivScreen        * ps );
+static void    queueUpload           ( CompScreen        * s,
+                                       PrivColorContext  * ccontext );
+static void    unqueueUpload         ( PrivScreen        * ps,
+                                       PrivColorContext  * ccontext );
 static void changeProperty           ( Display           * display,
                                        Atom                target_atom,
                                        int                 type,
                                        void              * data,
                                        unsigned long       size );
 static void *fetchProperty(Display *dpy, Window w, Atom prop, Atom type, unsigned long *n, Bool del);
-static oyStructList_s * pluginGetPrivatesCache ();
 
 static void *compObjectGetPrivate(CompObject *o)
 {
@@ -287,6 +533,66 @@ static void *compObjectGetPrivate(CompObject *o)
   return private_data;
 }
 
+/**
+ * The first call loads the Oyranos CMM modules and policy DB.
+ * Normally that happens in the warm up job, see warmUpOyranos(), but any
+ * earlier use initialises here on demand. Concurrent callers wait for the
+ * first one.
+ */
+static int iccProfileFlags( void )
+{
+  int flags = __atomic_load_n( &icc_profile_flags, __ATOMIC_ACQUIRE );
+
+  if(flags != -1)
+    return flags;
+
+  /* select profiles matching actual capabilities */
+  pthread_mutex_lock( &icc_profile_flags_mutex );
+  flags = icc_profile_flags;
+  if(flags == -1)
+  {
+    pthread_mutex_lock( &oy_mutex );
+    flags = oyICCProfileSelectionFlagsFromOptions( OY_CMM_STD, "//" OY_TYPE_STD "/icc_color", NULL, 0 );
+    pthread_mutex_unlock( &oy_mutex );
+    __atomic_store_n( &icc_profile_flags, flags, __ATOMIC_RELEASE );
+  }
+  pthread_mutex_unlock( &icc_profile_flags_mutex );
+
+  return flags;
+}
+
+/* Oyranos is initialised, without initialising it */
+static int oyranosReady( void )
+{
+  return __atomic_load_n( &icc_profile_flags, __ATOMIC_ACQUIRE ) != -1;
+}
+
+/* the assumed web profile; release with oyProfile_Release() */
+static oyProfile_s * webProfile( void )
+{
+  int flags = iccProfileFlags();
+  oyProfile_s * web;
+
+  pthread_mutex_lock( &oy_mutex );
+  web = oyProfile_FromStd( oyASSUMED_WEB, flags, 0 );
+  pthread_mutex_unlock( &oy_mutex );
+
+  return web;
+}
+
+/* oyProfile_FromMem() under oy_mutex */
+static oyProfile_s * profileFromMem  ( size_t              size,
+                                       const void        * data )
+{
+  oyProfile_s * prof;
+
+  pthread_mutex_lock( &oy_mutex );
+  prof = oyProfile_FromMem( size, data, 0, NULL );
+  pthread_mutex_unlock( &oy_mutex );
+
+  return prof;
+}
+
 static void compObjectFreePrivate(CompObject *o)
 {
   int index = -1;
@@ -438,30 +744,210 @@ static int getProfileShader(CompScreen *s, CompTexture *texture, int param, int
 }
 
 /**
- * Converts a server-side region to a client-side region.
+ * PrivRegion helpers. All loops run over plain arrays of short integers and
+ * can be vectorised by the compiler.
  */
-static Region convertRegion(Display *dpy, XserverRegion src)
+static void regionInit( PrivRegion * r )
+{
+  memset( r, 0, sizeof(PrivRegion) );
+}
+
+static void regionFini( PrivRegion * r )
 {
-  Region ret = XCreateRegion();
+  if(r->heap)
+    cicc_free( r->heap );
+  regionInit( r );
+}
 
-  int nRects = 0;
-  XRectangle *rect = XFixesFetchRegion(dpy, src, &nRects);
+static int regionIsEmpty( const PrivRegion * r )
+{
+  return r->nBoxes == 0;
+}
+
+/* make room for n boxes; returns 0 on success */
+static int regionReserve( PrivRegion * r, int n )
+{
+  BOX * heap;
+  int reserved;
+
+  if(n <= PRIV_REGION_BOXES || n <= r->reserved)
+    return 0;
+
+  reserved = r->reserved ? r->reserved : PRIV_REGION_BOXES;
+  while(reserved < n)
+    reserved *= 2;
+
+  heap = cicc_alloc( reserved * sizeof(BOX) );
+  if(!heap)
+    return 1;
+  memcpy( heap, REGION_BOXES(r), r->nBoxes * sizeof(BOX) );
+  if(r->heap)
+    cicc_free( r->heap );
+  r->heap = heap;
+  r->reserved = reserved;
+
+  return 0;
+}
+
+static void regionUpdateExtents( PrivRegion * r )
+{
+  BOX * b = REGION_BOXES(r);
+  BOX e = {0,0,0,0};
+
+  if(r->nBoxes)
+    e = b[0];
+  for(int i = 1; i < r->nBoxes; ++i)
+  {
+    e.x1 = b[i].x1 < e.x1 ? b[i].x1 : e.x1;
+    e.y1 = b[i].y1 < e.y1 ? b[i].y1 : e.y1;
+    e.x2 = b[i].x2 > e.x2 ? b[i].x2 : e.x2;
+    e.y2 = b[i].y2 > e.y2 ? b[i].y2 : e.y2;
+  }
+  r->extents = e;
+}
+
+/* append a box, which must not overlap the region */
+static void regionAddBox( PrivRegion * r, int x1, int y1, int x2, int y2 )
+{
+  BOX * b;
+
+  if(x1 >= x2 || y1 >= y2 || regionReserve( r, r->nBoxes + 1 ))
+    return;
+
+  b = REGION_BOXES(r) + r->nBoxes;
+  b->x1 = x1; b->y1 = y1; b->x2 = x2; b->y2 = y2;
+
+  if(r->nBoxes++ == 0)
+    r->extents = *b;
+  else
+  {
+    r->extents.x1 = x1 < r->extents.x1 ? x1 : r->extents.x1;
+    r->extents.y1 = y1 < r->extents.y1 ? y1 : r->extents.y1;
+    r->extents.x2 = x2 > r->extents.x2 ? x2 : r->extents.x2;
+    r->extents.y2 = y2 > r->extents.y2 ? y2 : r->extents.y2;
+  }
+}
+
+static void regionTranslate( PrivRegion * r, int dx, int dy )
+{
+  BOX * b = REGION_BOXES(r);
+
+  for(int i = 0; i < r->nBoxes; ++i)
+  {
+    b[i].x1 += dx; b[i].x2 += dx;
+    b[i].y1 += dy; b[i].y2 += dy;
+  }
+  if(r->nBoxes)
+  {
+    r->extents.x1 += dx; r->extents.x2 += dx;
+    r->extents.y1 += dy; r->extents.y2 += dy;
+  }
+}
 
-  for (int i = 0; i < nRects; ++i) {
-    XUnionRectWithRegion(&rect[i], ret, ret);
+/* dst = src clipped to the rectangle; dst must differ from src */
+static void regionIntersectRect( PrivRegion * dst, const PrivRegion * src,
+                                 const XRectangle * rect )
+{
+  const BOX * b = REGION_BOXES(src);
+  int cx1 = rect->x, cy1 = rect->y,
+      cx2 = rect->x + rect->width, cy2 = rect->y + rect->height;
+
+  dst->nBoxes = 0;
+  memset( &dst->extents, 0, sizeof(BOX) );
+
+  if(src->extents.x2 <= cx1 || src->extents.x1 >= cx2 ||
+     src->extents.y2 <= cy1 || src->extents.y1 >= cy2)
+    return;
+
+  for(int i = 0; i < src->nBoxes; ++i)
+  {
+    int x1 = b[i].x1 > cx1 ? b[i].x1 : cx1,
+        y1 = b[i].y1 > cy1 ? b[i].y1 : cy1,
+        x2 = b[i].x2 < cx2 ? b[i].x2 : cx2,
+        y2 = b[i].y2 < cy2 ? b[i].y2 : cy2;
+    regionAddBox( dst, x1, y1, x2, y2 );
+  }
+}
+
+/* r = r - sub */
+static void regionSubtract( PrivRegion * r, const PrivRegion * sub )
+{
+  const BOX * s = REGION_BOXES(sub);
+
+  if(r->extents.x2 <= sub->extents.x1 || r->extents.x1 >= sub->extents.x2 ||
+     r->extents.y2 <= sub->extents.y1 || r->extents.y1 >= sub->extents.y2)
+    return;
+
+  for(int j = 0; j < sub->nBoxes && r->nBoxes; ++j)
+  {
+    PrivRegion tmp;
+    const BOX * b = REGION_BOXES(r);
+
+    regionInit( &tmp );
+    for(int i = 0; i < r->nBoxes; ++i)
+    {
+      /* keep what is outside of s[j], split into up to four bands */
+      if(b[i].x2 <= s[j].x1 || b[i].x1 >= s[j].x2 ||
+         b[i].y2 <= s[j].y1 || b[i].y1 >= s[j].y2)
+      {
+        regionAddBox( &tmp, b[i].x1, b[i].y1, b[i].x2, b[i].y2 );
+        continue;
+      }
+      int y1 = b[i].y1 > s[j].y1 ? b[i].y1 : s[j].y1,
+          y2 = b[i].y2 < s[j].y2 ? b[i].y2 : s[j].y2;
+      regionAddBox( &tmp, b[i].x1, b[i].y1, b[i].x2, y1 );
+      regionAddBox( &tmp, b[i].x1, y1, s[j].x1 < b[i].x2 ? s[j].x1 : b[i].x2, y2 );
+      regionAddBox( &tmp, s[j].x2 > b[i].x1 ? s[j].x2 : b[i].x1, y1, b[i].x2, y2 );
+      regionAddBox( &tmp, b[i].x1, y2, b[i].x2, b[i].y2 );
+    }
+    regionFini( r );
+    *r = tmp;
   }
 
-  XFree(rect);
+  regionUpdateExtents( r );
+}
+
+static int regionEqual( const PrivRegion * a, const PrivRegion * b )
+{
+  return a->nBoxes == b->nBoxes &&
+         memcmp( REGION_BOXES(a), REGION_BOXES(b), a->nBoxes * sizeof(BOX) ) == 0;
+}
+
+/**
+ * Wrap a PrivRegion as Xlib Region for compiz functions without copying.
+ * The returned Region is valid as long as r and tmp are unchanged.
+ */
+static Region regionToXRegion( const PrivRegion * r, REGION * tmp )
+{
+  tmp->rects = (BOX*) REGION_BOXES(r);
+  tmp->numRects = tmp->size = r->nBoxes;
+  tmp->extents = r->extents;
+  return tmp;
+}
+
+/**
+ * Converts a server-side region to a client-side region.
+ */
+static void convertRegion(Display *dpy, XserverRegion src, PrivRegion *r)
+{
+  int nRects = 0;
+  XRectangle *rect = XFixesFetchRegion(dpy, src, &nRects);
+
+  regionInit( r );
+  regionReserve( r, nRects );
+  /* XFixes delivers not overlapping rectangles */
+  for (int i = 0; i < nRects; ++i)
+    regionAddBox( r, rect[i].x, rect[i].y,
+                  rect[i].x + rect[i].width, rect[i].y + rect[i].height );
 
-  return ret;
+  if(rect)
+    XFree(rect);
 }
 
-static Region windowRegion( CompWindow * w )
+static void windowRegion( CompWindow * w, PrivRegion * r )
 {
-  Region r = XCreateRegion();
-  XRectangle rect = {0,0,w->serverWidth, w->serverHeight};
-  XUnionRectWithRegion( &rect, r, r );
- return r;
+  regionInit( r );
+  regionAddBox( r, 0, 0, w->serverWidth, w->serverHeight );
 }
 
 /**
@@ -473,14 +959,19 @@ static void *fetchProperty(Display *dpy, Window w, Atom prop, Atom type, unsigne
   int format;
   unsigned long left;
   unsigned char *data;
-  const char * atom_name = XGetAtomName( dpy, prop );
 
   XFlush( dpy );
 
   int result = XGetWindowProperty( dpy, w, prop, 0, ~0, del, type, &actual,
                                    &format, n, &left, &data );
 
-  oyCompLogMessage(d, "compicc", CompLogLevelDebug, DBG_STRING "XGetWindowProperty w: %lu atom: %s n: %lu left: %lu", DBG_ARGS, w, atom_name, *n, left  );
+  /* XGetAtomName() is a round trip; ask only when debugging */
+  if(oy_debug)
+  {
+    char * atom_name = XGetAtomName( dpy, prop );
+    oyCompLogMessage(d, "compicc", CompLogLevelDebug, DBG_STRING "XGetWindowProperty w: %lu atom: %s n: %lu left: %lu", DBG_ARGS, w, atom_name, *n, left  );
+    XFree( atom_name );
+  }
 
   if(del)
   printf( "compicc erasing atom %lu\n", prop );
@@ -491,1065 +982,3585 @@ static void *fetchProperty(Display *dpy, Window w, Atom prop, Atom type, unsigne
 }
 
 /**
- * Called when new profiles have been attached to the root window. Fetches
- * these and saves them in a local database.
- */ 
-static void updateScreenProfiles(CompScreen *s)
+ * Obtain the size of a 8-bit window property without transfering its data.
+ */
+static unsigned long propertySize    ( Display           * dpy,
+                                       Window              w,
+                                       Atom                prop,
+                                       Atom                type )
 {
-  CompDisplay *d = s->display;
-  PrivDisplay *pd = compObjectGetPrivate((CompObject *) d);
+  Atom actual;
+  int format;
+  unsigned long n = 0, left = 0;
+  unsigned char * data = NULL;
 
-  /* Fetch the profiles */
-  unsigned long nBytes;
-  int screen = DefaultScreen( s->display->display );
-  void *data = fetchProperty(d->display,
-                                   XRootWindow( s->display->display, screen ),
-                                   pd->iccColorProfiles,
-                                   XA_CARDINAL, &nBytes, True);
-  if (data == NULL)
-    return;
+  int result = XGetWindowProperty( dpy, w, prop, 0, 0, False, type, &actual,
+                                   &format, &n, &left, &data );
+  if(data)
+    XFree( data );
 
-  uint32_t exact_hash_size = 0;
-  oyHash_s * entry;
-  oyProfile_s * prof = NULL;
-  oyStructList_s * cache = pluginGetPrivatesCache();
-  int n = 0;
+  if(result != Success || actual == None || format != 8)
+    return 0;
 
-  /* Grow or shring the array as needed. */
-  unsigned long count = XcolorProfileCount(data, nBytes);
+  return left;
+}
 
-  /* Copy the profiles into the array, and create the Oyranos handles. */
-  XcolorProfile *profile = data;
-  for (unsigned long i = 0; i < count; ++i)
+/**
+ * Fetch a 8-bit window property in chunks of ICC_PROPERTY_CHUNK_SIZE.
+ * The data is placed into the reusable buffer and hashed after reading.
+ * When the property changes between two chunks, the read starts again.
+ *
+ * @return                             - 0  buf holds the property
+ *                                     - 1  no property
+ *                                     - 2  error or too large
+ */
+static int     fetchPropertyChunked  ( Display           * dpy,
+                                       Window              w,
+                                       Atom                prop,
+                                       Atom                type,
+                                       PrivPropertyBuffer* buf )
+{
+  int retries = ICC_PROPERTY_RETRIES;
+  long offset;
+  unsigned long left = 0, total;
+
+  XFlush( dpy );
+
+restart:
+  buf->size = 0;
+  offset = 0;
+  total = 0;
+
+  do
   {
-    const char * hash_text = md5string(profile->md5);
-    entry = oyStructList_GetHash( cache, exact_hash_size, hash_text );
-    prof = (oyProfile_s *) oyHash_GetPointer( entry, oyOBJECT_PROFILE_S);
-    /* XcolorProfile::length == 0 means the clients wants to delete the profile. */
-    if( ntohl(profile->length) )
+    Atom actual;
+    int format;
+    unsigned long n = 0;
+    unsigned char * chunk = NULL;
+
+    /* offset and length are counted in 32-bit units */
+    int result = XGetWindowProperty( dpy, w, prop, offset,
+                                     ICC_PROPERTY_CHUNK_SIZE / 4, False, type,
+                                     &actual, &format, &n, &left, &chunk );
+    if(result != Success || actual == None || format != 8)
     {
-      if(!prof)
-      {
-        prof = oyProfile_FromMem( htonl(profile->length), profile + 1, 0,NULL );
+      if(chunk) XFree( chunk );
+      buf->size = 0;
+      if(result == Success && actual == None)
+        return offset ? 2 : 1;
+      return 2;
+    }
 
-        if(!prof)
-        {
-          /* If creating the Oyranos profile fails, don't try to parse any further profiles and just quit. */
-          oyCompLogMessage(d, "compicc", CompLogLevelWarn, "Couldn't create Oyranos profile %s", hash_text );
-          goto out;
-        }
+    /* a changed property has another size or is too short for the offset */
+    if(offset && buf->size + n + left != total)
+    {
+      XFree( chunk );
+      if(retries-- > 0)
+        goto restart;
+      oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
+                        DBG_STRING "property %lu changed while reading",
+                        DBG_ARGS, prop );
+      buf->size = 0;
+      return 2;
+    }
+    total = buf->size + n + left;
 
-        oyHash_SetPointer( entry, (oyStruct_s*) prof );
-        ++n;
+    if(total > ICC_PROPERTY_MAX_SIZE)
+    {
+      oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
+                        DBG_STRING "ignoring property %lu of %lu bytes",
+                        DBG_ARGS, prop, total );
+      XFree( chunk );
+      buf->size = 0;
+      return 2;
+    }
+
+    if(total > buf->reserved)
+    {
+      unsigned char * data = cicc_alloc( total );
+      if(!data)
+      {
+        XFree( chunk );
+        buf->size = 0;
+        return 2;
+      }
+      if(buf->data)
+      {
+        memcpy( data, buf->data, buf->size );
+        cicc_free( buf->data );
       }
+      buf->data = data;
+      buf->reserved = total;
     }
 
-    profile = XcolorProfileNext(profile);
-  }
+    memcpy( buf->data + buf->size, chunk, n );
+    buf->size += n;
+    offset += ICC_PROPERTY_CHUNK_SIZE / 4;
 
-#if defined(PLUGIN_DEBUG_)
-  oyCompLogMessage(d, "compicc", CompLogLevelDebug, "Added %d of %d screen profiles",
-		      n, count);
-#endif
+    XFree( chunk );
+  } while(left);
 
-  out:
-  XFree(data);
+  if(buf->size)
+    oyMiscBlobGetMD5_( buf->data, buf->size, buf->md5 );
+
+  return buf->size ? 0 : 1;
 }
 
-oyProfile_s *  profileFromMD5        ( uint8_t           * md5 )
+/**
+ * Give the memory of a large property buffer back after use.
+ */
+static void    trimPropertyBuffer    ( PrivPropertyBuffer* buf )
 {
-  uint32_t exact_hash_size = 0;
-  oyProfile_s * prof = NULL;
-  oyStructList_s * cache = pluginGetPrivatesCache();
-
-  /* Copy the profiles into the array, and create the Oyranos handles. */
-  const char * hash_text = md5string(md5);
-  prof = (oyProfile_s *) oyStructList_GetHashStruct( cache, exact_hash_size,
-                                               hash_text, oyOBJECT_PROFILE_S );
+  if(buf->reserved <= ICC_PROPERTY_KEEP_SIZE)
+    return;
 
-  return prof;
+  cicc_free( buf->data );
+  buf->data = NULL;
+  buf->size = buf->reserved = 0;
 }
 
 /**
- * Called when new regions have been attached to a window. Fetches these and
- * saves them in the local list.
+ * Profiles and CLUTs are kept in a hash table, which is read from the event
+ * handler, paint and the workers. Readers walk the bucket chains without a
+ * lock: an entry is complete, before a release store puts it in front of
+ * its bucket. Writers lock only the stripe of their bucket.
+ *
+ * Entries are reference counted. References are taken under the stripe
+ * lock, so an entry without references can not gain one, while
+ * cacheEvict() unlinks it on the compositor thread. Unlinked entries are
+ * freed after a grace period: once no reader is inside cacheReadBegin()
+ * and cacheReadEnd(), no thread can still see them. Profiles uploaded
+ * through _ICC_COLOR_PROFILES are pinned until the client deletes them.
  */
-static void updateWindowRegions(CompWindow *w)
-{
-  PrivWindow *pw = compObjectGetPrivate((CompObject *) w);
+#define CACHE_BUCKETS 256
+#define CACHE_LOCKS   16
+
+struct PrivCacheEntry {
+  PrivCacheEntry * next;
+  char * key;
+  oyProfile_s * profile;             /* a profile entry or */
+  GLushort (*clut)[GRIDPOINTS][GRIDPOINTS][3]; /* a CLUT entry */
+  int refs;                          /* atomic */
+  int pinned;                        /* holds a reference; stripe lock */
+};
 
-  CompDisplay *d = w->screen->display;
-  PrivDisplay *pd = compObjectGetPrivate((CompObject *) d);
-  PrivScreen *ps = compObjectGetPrivate((CompObject *) w->screen);
+static PrivCacheEntry * privates_cache[CACHE_BUCKETS];
+static pthread_mutex_t privates_cache_locks[CACHE_LOCKS];
+/* threads inside a lock-free read; atomic */
+static int cache_readers = 0;
+/* an entry lost its last reference or waits in cache_retired; atomic */
+static int cache_evict_pending = 0;
+/* unlinked entries waiting for the readers; compositor thread only */
+static PrivCacheEntry * cache_retired = NULL;
+
+static unsigned int cacheBucket( const char * key )
+{
+  uint32_t h = 2166136261u;          /* FNV-1a */
 
-  /* free existing data structures */
-  for (unsigned long i = 0; i < pw->nRegions; ++i)
+  while(*key)
   {
-    if (pw->pRegion[i].xRegion != 0) {
-      XDestroyRegion(pw->pRegion[i].xRegion);
-    }
-    if(pw->pRegion[i].cc)
-    {
-      for(unsigned long j = 0; j < ps->nContexts; ++j)
-      {
-        if(pw->pRegion[i].cc[j])
-        {
-          oyProfile_Release( &pw->pRegion[i].cc[j]->dst_profile );
-          oyProfile_Release( &pw->pRegion[i].cc[j]->src_profile );
-          if(&pw->pRegion[i].cc[j]->glTexture)
-            glDeleteTextures( 1, &pw->pRegion[i].cc[j]->glTexture );
-          cicc_free( pw->pRegion[i].cc[j] );
-          pw->pRegion[i].cc[j] = NULL;
-        }
-        else
-          break;
-      }
-      cicc_free( pw->pRegion[i].cc ); pw->pRegion[i].cc = 0;
-    }
+    h ^= (unsigned char) *key++;
+    h *= 16777619u;
   }
-  if (pw->nRegions)
-    cicc_free(pw->pRegion);
-  pw->nRegions = 0;
-  oyRectangle_Release( &pw->absoluteWindowRectangleOld );
-
-
-  /* fetch the regions */
-  unsigned long nBytes;
-  void *data = fetchProperty( d->display, w->id, pd->iccColorRegions,
-                              XA_CARDINAL, &nBytes, False );
-
-  /* allocate the list */
-  unsigned long count = 1;
-  if(data)
-    count += XcolorRegionCount(data, nBytes + 1);
-
-  if(oy_debug)
-  fprintf( stderr, DBG_STRING"XcolorRegionCount+1=%lu\n", DBG_ARGS,
-           count );
-
-  pw->pRegion = (PrivColorRegion*) cicc_alloc(count * sizeof(PrivColorRegion));
-  if (pw->pRegion == NULL)
-    goto out;
+  return h % CACHE_BUCKETS;
+}
 
-  /* get the complete windows region and put it at the end */
-  pw->pRegion[count-1].xRegion = windowRegion( w );
+/* the order against the unlink in cacheEvict() needs sequential consistency */
+static void cacheReadBegin( void )
+{
+  __atomic_add_fetch( &cache_readers, 1, __ATOMIC_SEQ_CST );
+}
 
+static void cacheReadEnd( void )
+{
+  __atomic_sub_fetch( &cache_readers, 1, __ATOMIC_SEQ_CST );
+}
 
-  /* fill in the possible application region(s) */
-  XcolorRegion *region = data;
-  Region wRegion = pw->pRegion[count-1].xRegion;
-  for (unsigned long i = 0; i < (count - 1); ++i)
-  {
-    uint8_t n[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
-    pw->pRegion[i].xRegion = convertRegion( d->display, ntohl(region->region) );
-    memcpy( pw->pRegion[i].md5, region->md5, 16 );
+/* call inside cacheReadBegin()/cacheReadEnd() or with the stripe locked */
+static PrivCacheEntry * cacheLookup  ( const char        * key )
+{
+  PrivCacheEntry * e;
 
-    /* substract a application region from the window region */
-    XSubtractRegion( wRegion, pw->pRegion[i].xRegion, wRegion );
+  if(!key)
+    return NULL;
 
-    if(memcmp(region->md5,n,16) != 0)
-    {
-      pw->pRegion[i].cc = (PrivColorContext**)cicc_alloc( (ps->nContexts + 1) *
-                                                    sizeof(PrivColorContext*));
-      if(!pw->pRegion[i].cc)
-      {
-        printf( DBG_STRING "Could not allocate contexts. Stop!\n",
-                DBG_ARGS );
-        goto out;
-      }
+  e = __atomic_load_n( &privates_cache[cacheBucket( key )], __ATOMIC_ACQUIRE );
+  while(e && strcmp( e->key, key ) != 0)
+    e = e->next;
+  return e;
+}
 
-      for(unsigned long j = 0; j < ps->nContexts; ++j)
-      {
-        pw->pRegion[i].cc[j] = (PrivColorContext*) cicc_alloc(
-                                                     sizeof(PrivColorContext) );
+static int     cacheHas              ( const char        * key )
+{
+  int found;
 
-        if(!pw->pRegion[i].cc[j])
-        {
-          printf( DBG_STRING "Could not allocate context. Stop!\n",
-                  DBG_ARGS );
-          goto out;
-        }
+  cacheReadBegin();
+  found = cacheLookup( key ) != NULL;
+  cacheReadEnd();
 
-        if(ps && ps->nContexts > 0)
-        {
-          pw->pRegion[i].cc[j]->dst_profile = oyProfile_Copy(
-                                            ps->contexts[j].cc.dst_profile, 0 );
+  return found;
+}
 
-          if(!pw->pRegion[i].cc[j]->dst_profile)
-          {
-            printf( DBG_STRING "output 0 not ready\n",
-                    DBG_ARGS );
-            continue;
-          }
-          pw->pRegion[i].cc[j]->src_profile = profileFromMD5(region->md5);
-          fprintf( stderr, DBG_STRING"region->md5: %s\n", DBG_ARGS,
-                   oyProfile_GetText( pw->pRegion[i].cc[j]->src_profile, oyNAME_DESCRIPTION ) );
-
-          pw->pRegion[i].cc[j]->output_name = strdup(
-                                               ps->contexts[j].cc.output_name );
-        } else
-          printf( DBG_STRING "output_name: %s\n",
-                  DBG_ARGS, ps->contexts[j].cc.output_name);
-
-        if(pw->pRegion[i].cc[j]->src_profile)
-          setupColourTable( pw->pRegion[i].cc[j],
-                            getDisplayAdvanced(w->screen, 0), w->screen );
-        else
-          printf( DBG_STRING "region %lu on %lu has no source profile!\n",
-                  DBG_ARGS, i, j );
-      }
-    } else if(oy_debug)
-      fprintf( stderr, DBG_STRING"no region->md5 %lu cc=0x%lx %d,%d,%dx%d\n", DBG_ARGS,
-               i, (unsigned long)pw->pRegion[i].cc, pw->pRegion[i].xRegion->extents.x1,
-               pw->pRegion[i].xRegion->extents.y1,
-               pw->pRegion[i].xRegion->extents.x2-pw->pRegion[i].xRegion->extents.x1,
-               pw->pRegion[i].xRegion->extents.y2-pw->pRegion[i].xRegion->extents.y1
- );
+static pthread_mutex_t * cacheLock   ( const char        * key )
+{
+  return &privates_cache_locks[cacheBucket( key ) % CACHE_LOCKS];
+}
 
-    region = XcolorRegionNext(region);
-  }
+/**
+ * Find the entry for key and take a reference on it.
+ *
+ * @return                             the entry or NULL;
+ *                                     give it back with cacheRelease()
+ */
+static PrivCacheEntry * cacheAcquire ( const char        * key )
+{
+  pthread_mutex_t * lock;
+  PrivCacheEntry * e;
 
-  pw->nRegions = count;
-  pw->active = 1;
+  if(!key)
+    return NULL;
 
-  pw->absoluteWindowRectangleOld = oyRectangle_NewWith( 0, 0, w->serverWidth,
-                                                        w->serverHeight, 0 );
+  lock = cacheLock( key );
+  pthread_mutex_lock( lock );
+  e = cacheLookup( key );
+  if(e)
+    __atomic_add_fetch( &e->refs, 1, __ATOMIC_RELAXED );
+  pthread_mutex_unlock( lock );
 
-  addWindowDamage(w);
+  return e;
+}
 
-out:
-  XFree(data);
-#if defined(PLUGIN_DEBUG_)
-  if(count > 1)
-  oyCompLogMessage(d, "compicc", CompLogLevelDebug, "Added %d regions",
-		      count);
-#endif
+/* give a reference back; the entry might be evicted afterwards */
+static void    cacheRelease          ( PrivCacheEntry   ** e )
+{
+  if(!*e)
+    return;
 
+  if(__atomic_sub_fetch( &(*e)->refs, 1, __ATOMIC_ACQ_REL ) == 0)
+    __atomic_store_n( &cache_evict_pending, 1, __ATOMIC_RELAXED );
+  *e = NULL;
 }
 
-
 /**
- * Called when the window target (_ICC_COLOR_TARGET) has been changed.
+ * Add profile or clut under key. The entry takes over both.
+ *
+ * @return                             the entry for key with a reference
+ *                                     taken; an older one wins and the
+ *                                     arguments are released;
+ *                                     NULL without key or memory, the arguments
+ *                                     stay with the caller
  */
-static void updateWindowOutput(CompWindow *w)
+static PrivCacheEntry * cacheInsert  ( const char        * key,
+                                       oyProfile_s       * profile,
+                                       GLushort         (* clut)[GRIDPOINTS][GRIDPOINTS][3] )
 {
-  PrivWindow *pw = compObjectGetPrivate((CompObject *) w);
-
-  CompDisplay *d = w->screen->display;
-  PrivDisplay *pd = compObjectGetPrivate((CompObject *) d);
+  unsigned int b;
+  pthread_mutex_t * lock;
+  PrivCacheEntry * e;
+
+  if(!key)
+    return NULL;
+
+  b = cacheBucket( key );
+  lock = cacheLock( key );
+  pthread_mutex_lock( lock );
+  e = cacheLookup( key );
+  if(!e)
+  {
+    e = cicc_alloc( sizeof(PrivCacheEntry) );
+    if(!e || !(e->key = strdup( key )))
+    {
+      pthread_mutex_unlock( lock );
+      if(e)
+        cicc_free( e );
+      return NULL;
+    }
 
-  if (pw->output)
-    XFree(pw->output);
+    e->profile = profile;
+    e->clut = clut;
+    e->refs = 0;
+    e->pinned = 0;
+    e->next = privates_cache[b];
+    __atomic_store_n( &privates_cache[b], e, __ATOMIC_RELEASE );
+    profile = NULL;
+    clut = NULL;
+  }
+  __atomic_add_fetch( &e->refs, 1, __ATOMIC_RELAXED );
+  pthread_mutex_unlock( lock );
 
-  unsigned long nBytes;
-  pw->output = fetchProperty(d->display, w->id, pd->iccColorOutputs, XA_STRING, &nBytes, False);
+  oyProfile_Release( &profile );
+  if(clut)
+    cicc_free( clut );
 
-  if(!pw->nRegions)
-    addWindowDamage(w);
+  return e;
 }
 
-static void cdCreateTexture( PrivColorContext *ccontext )
+/* keep the entry for key without a user, until it is unpinned */
+static void    cachePin              ( const char        * key,
+                                       int                 pin )
 {
-    glBindTexture(GL_TEXTURE_3D, ccontext->glTexture);
+  pthread_mutex_t * lock;
+  PrivCacheEntry * e;
 
-    ccontext->scale = (GLfloat) (GRIDPOINTS - 1) / GRIDPOINTS;
-    ccontext->offset = (GLfloat) 1.0 / (2 * GRIDPOINTS);
+  if(!key)
+    return;
 
+  lock = cacheLock( key );
+  pthread_mutex_lock( lock );
+  e = cacheLookup( key );
+  if(e && e->pinned != pin)
+  {
+    e->pinned = pin;
+    if(pin)
+      __atomic_add_fetch( &e->refs, 1, __ATOMIC_RELAXED );
+  }
+  else
+    e = NULL;
+  pthread_mutex_unlock( lock );
 
-    glGenTextures(1, &ccontext->glTexture);
-    glBindTexture(GL_TEXTURE_3D, ccontext->glTexture);
+  if(e && !pin)
+    cacheRelease( &e );
+}
 
-    fprintf( stderr, DBG_STRING"glTexture=%d\n", DBG_ARGS,
-             ccontext->glTexture );
+/* returned profile is owned by the caller */
+static oyProfile_s * cacheGetProfile( const char * key )
+{
+  oyProfile_s * profile = NULL;
+  PrivCacheEntry * e;
 
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  cacheReadBegin();
+  e = cacheLookup( key );
+  if(e)
+    profile = oyProfile_Copy( e->profile, 0 );
+  cacheReadEnd();
 
-    glTexImage3D( GL_TEXTURE_3D, 0, GL_RGB16, GRIDPOINTS,GRIDPOINTS,GRIDPOINTS,
-                  0, GL_RGB, GL_UNSIGNED_SHORT, ccontext->clut);
+  return profile;
 }
 
-/* returned data is owned by user;
- * free with XFree(returned_data)
- */
-static oyPointer   getScreenProfile  ( CompScreen        * s,
-                                       int                 screen,
-                                       int                 server,
-                                       size_t            * size )
+static void    cacheSetProfile       ( const char        * key,
+                                       oyProfile_s       * profile )
 {
-  char num[12];
-  Window root = RootWindow( s->display->display, 0 );
-  char * icc_profile_atom = (char*)cicc_alloc( 1024 );
-  Atom a;
-  oyPointer data;
-  unsigned long n = 0;
+  oyProfile_s * copy = oyProfile_Copy( profile, 0 );
+  PrivCacheEntry * e = cacheInsert( key, copy, NULL );
 
-  if(!icc_profile_atom) return 0;
+  if(!e)
+    oyProfile_Release( &copy );
+  cacheRelease( &e );
+}
 
-  snprintf( num, 12, "%d", (int)screen );
-  if(server)
-  snprintf( icc_profile_atom, 1024, XCM_DEVICE_PROFILE"%s%s", 
-            screen ? "_" : "", screen ? num : "" );
-  else
-  snprintf( icc_profile_atom, 1024, XCM_ICC_V0_3_TARGET_PROFILE_IN_X_BASE"%s%s", 
-            screen ? "_" : "", screen ? num : "" );
+static void    cacheFreeEntry        ( PrivCacheEntry    * e )
+{
+  oyProfile_Release( &e->profile );
+  if(e->clut)
+    cicc_free( e->clut );
+  free( e->key );
+  cicc_free( e );
+}
 
+/**
+ * Unlink the entries without references and free the ones, which no reader
+ * can see anymore. Runs on the compositor thread, when something is pending.
+ */
+static void    cacheEvict            ( void )
+{
+  if(!__atomic_exchange_n( &cache_evict_pending, 0, __ATOMIC_RELAXED ))
+    return;
 
-  a = XInternAtom(s->display->display, icc_profile_atom, False);
+  for(int b = 0; b < CACHE_BUCKETS; ++b)
+  {
+    pthread_mutex_t * lock = &privates_cache_locks[b % CACHE_LOCKS];
+    PrivCacheEntry ** prev = &privates_cache[b];
 
-  oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                    DBG_STRING"fetching profile from %s atom: %d",
-                    DBG_ARGS,
-                    icc_profile_atom, a);
-  
-  data = fetchProperty( s->display->display, root, a, XA_CARDINAL,
-                        &n, False);
-  oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                    DBG_STRING"fetching %s, found %lu: %s",
-                    DBG_ARGS,
-                    icc_profile_atom,
-                    n, (data == NULL ? "no data":"some data obtained") );
-  *size = (size_t)n;
-  cicc_free(icc_profile_atom);
-  return data;
+    pthread_mutex_lock( lock );
+    while(*prev)
+    {
+      PrivCacheEntry * e = *prev;
+      if(__atomic_load_n( &e->refs, __ATOMIC_ACQUIRE ) == 0)
+      {
+        /* readers in e keep going through the unchanged e->next */
+        __atomic_store_n( prev, e->next, __ATOMIC_SEQ_CST );
+        e->next = cache_retired;
+        cache_retired = e;
+      } else
+        prev = &e->next;
+    }
+    pthread_mutex_unlock( lock );
+  }
+
+  /* a reader starting now does not find the unlinked entries */
+  if(__atomic_load_n( &cache_readers, __ATOMIC_SEQ_CST ) == 0)
+  {
+    while(cache_retired)
+    {
+      PrivCacheEntry * e = cache_retired;
+      cache_retired = e->next;
+      cacheFreeEntry( e );
+    }
+  } else
+    __atomic_store_n( &cache_evict_pending, 1, __ATOMIC_RELAXED );
 }
 
-static void changeProperty           ( Display           * display,
-                                       Atom                target_atom,
-                                       int                 type,
-                                       void              * data,
-                                       unsigned long       size )
+static void cacheInit( void )
 {
-  const char * atom_name = XGetAtomName( display, target_atom );
-  oyCompLogMessage( display, "compicc", CompLogLevelDebug,
-                    DBG_STRING"XChangeProperty atom: %s size: %lu",
-                    DBG_ARGS,
-                    atom_name, size );
-    XChangeProperty( display, RootWindow( display, 0 ),
-                     target_atom, type, 8, PropModeReplace,
-                     data, size );
+  for(int i = 0; i < CACHE_LOCKS; ++i)
+    pthread_mutex_init( &privates_cache_locks[i], NULL );
 }
 
-static void    moveICCprofileAtoms   ( CompScreen        * s,
-                                       int                 screen,
-                                       int                 init )
+static void cacheFini( void )
 {
+  for(int b = 0; b < CACHE_BUCKETS; ++b)
   {
-    oyOptions_s * opts = 0,
-                * result = 0;
+    PrivCacheEntry * e = privates_cache[b];
+    while(e)
+    {
+      PrivCacheEntry * next = e->next;
+      cacheFreeEntry( e );
+      e = next;
+    }
+    privates_cache[b] = NULL;
+  }
+  while(cache_retired)
+  {
+    PrivCacheEntry * e = cache_retired;
+    cache_retired = e->next;
+    cacheFreeEntry( e );
+  }
+  for(int i = 0; i < CACHE_LOCKS; ++i)
+    pthread_mutex_destroy( &privates_cache_locks[i] );
+}
 
-    const char * display_name = strdup(XDisplayString(s->display->display));
+/**
+ * Read a profile from a window property. The property bytes are hashed after
+ * reading and only parsed, if no profile with the same MD5 is in the cache.
+ */
+static oyProfile_s * profileFromProperty( CompDisplay    * d,
+                                       Window              w,
+                                       Atom                prop,
+                                       size_t            * size )
+{
+  PrivDisplay * pd = compObjectGetPrivate((CompObject *) d);
+  PrivPropertyBuffer * buf = &pd->profileBuffer;
+  oyProfile_s * prof;
+  char hash_text[48];
+
+  *size = 0;
+  if(fetchPropertyChunked( d->display, w, prop, XA_CARDINAL, buf ) != 0)
+    return NULL;
+  *size = buf->size;
+
+  snprintf( hash_text, sizeof(hash_text), "property:%s", md5string(buf->md5) );
+  prof = cacheGetProfile( hash_text );
+  oyCompLogMessage( d, "compicc", CompLogLevelDebug,
+                    DBG_STRING "profile %s from cache %s, size: %lu",
+                    DBG_ARGS, hash_text, prof ? "obtained" : "no", buf->size );
+  if(!prof)
+  {
+    prof = profileFromMem( buf->size, buf->data );
+    if(prof)
+      cacheSetProfile( hash_text, prof );
+  }
 
-    oyOptions_SetFromString( &opts, "////display_name",
-                           display_name, OY_CREATE_NEW );
+  trimPropertyBuffer( buf );
 
-    oyOptions_SetFromInt( &opts, "////screen", screen, 0, OY_CREATE_NEW );
-    oyOptions_SetFromInt( &opts, "////setup", init, 0, OY_CREATE_NEW );
-    oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                  DBG_STRING "Moving profiles on %s: for screen %d setup %d",
-                  DBG_ARGS, display_name, screen, init );
-    //fprintf( stderr, "Moving profiles on %s: for screen %d setup %d\n",
-    //                 display_name, screen, init );
-    oyOptions_Handle( "//" OY_TYPE_STD "/move_color_server_profiles",
-                                opts,"move_color_server_profiles",
-                                &result );
-    oyOptions_Release( &opts );
-    oyOptions_Release( &result );
-    return;
-  }
+  return prof;
 }
 
-static int     getDeviceProfile      ( CompScreen        * s,
-                                       PrivScreen        * ps,
-                                       oyConfig_s        * device,
-                                       int                 screen )
+/**
+ * Called when new profiles have been attached to the root window. Fetches
+ * these and saves them in a local database.
+ */ 
+static void updateScreenProfiles(CompScreen *s)
 {
-  PrivColorOutput * output = &ps->contexts[screen];
-  oyOption_s * o = 0;
-  oyRectangle_s * r = 0;
-  const char * device_name = 0;
-  char num[12];
-  int error = 0, t_err = 0;
+  CompDisplay *d = s->display;
+  PrivDisplay *pd = compObjectGetPrivate((CompObject *) d);
 
-  snprintf( num, 12, "%d", (int)screen );
+  /* Fetch the profiles */
+  unsigned long nBytes;
+  int screen = DefaultScreen( s->display->display );
+  void *data = fetchProperty(d->display,
+                                   XRootWindow( s->display->display, screen ),
+                                   pd->iccColorProfiles,
+                                   XA_CARDINAL, &nBytes, True);
+  if (data == NULL)
+    return;
 
-    o = oyConfig_Find( device, "device_rectangle" );
-    if( !o )
-    {
-      oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
-                      DBG_STRING"monitor rectangle request failed", DBG_ARGS);
-      return 1;
-    }
-    r = (oyRectangle_s*) oyOption_GetStruct( o, oyOBJECT_RECTANGLE_S );
-    if( !r )
-    {
-      oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
-                      DBG_STRING"monitor rectangle request failed", DBG_ARGS);
-      return 1;
-    }
-    oyOption_Release( &o );
+  oyProfile_s * prof = NULL;
+  int n = 0;
 
-    output->xRect.x = oyRectangle_GetGeo1( r, 0 );
-    output->xRect.y = oyRectangle_GetGeo1( r, 1 );
-    output->xRect.width = oyRectangle_GetGeo1( r, 2 );
-    output->xRect.height = oyRectangle_GetGeo1( r, 3 );
+  /* Grow or shring the array as needed. */
+  unsigned long count = XcolorProfileCount(data, nBytes);
 
-    device_name = oyConfig_FindString( device, "device_name", 0 );
-    if(device_name && device_name[0])
+  /* Copy the profiles into the array, and create the Oyranos handles. */
+  XcolorProfile *profile = data;
+  for (unsigned long i = 0; i < count; ++i)
+  {
+    const char * hash_text = md5string(profile->md5);
+    /* XcolorProfile::length == 0 means the clients wants to delete the profile. */
+    if( ntohl(profile->length) )
     {
-      strcpy( output->name, device_name );
+      if(!cacheHas( hash_text ))
+      {
+        PrivCacheEntry * e;
+        prof = profileFromMem( htonl(profile->length), profile + 1 );
+
+        if(!prof)
+        {
+          /* If creating the Oyranos profile fails, don't try to parse any further profiles and just quit. */
+          oyCompLogMessage(d, "compicc", CompLogLevelWarn, "Couldn't create Oyranos profile %s", hash_text );
+          goto out;
+        }
 
+        e = cacheInsert( hash_text, prof, NULL );
+        if(!e)
+          oyProfile_Release( &prof );
+        cacheRelease( &e );
+        ++n;
+      }
+      /* regions refer to it by MD5 until the client deletes it */
+      cachePin( hash_text, 1 );
     } else
-    {
-       oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
-       DBG_STRING "oyDevicesGet list answere included no device_name",DBG_ARGS);
+      cachePin( hash_text, 0 );
 
-       strcpy( output->name, num );
-    }
+    profile = XcolorProfileNext(profile);
+  }
 
-    oyProfile_Release( &output->cc.dst_profile );
+#if defined(PLUGIN_DEBUG_)
+  oyCompLogMessage(d, "compicc", CompLogLevelDebug, "Added %d of %d screen profiles",
+		      n, count);
+#endif
 
-    size_t size = 0;
-    int server = 1;
-    /* try to get the device profile atom */
-    oyPointer pp = getScreenProfile( s, screen, server, &size );
+  out:
+  XFree(data);
+}
 
-    /* check if the normal profile atom is a device profile */
-    if(!pp)
-    {
-      server = 0;
-      pp = getScreenProfile( s, screen, server, &size );
-      if(!pp)
-      oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                      DBG_STRING "no server profile on %s, size: %d",
-                      DBG_ARGS, output->name, (int)size);
+oyProfile_s *  profileFromMD5        ( uint8_t           * md5 )
+{
+  return cacheGetProfile( md5string(md5) );
+}
 
-      /* filter out ordinary sRGB */
-      if(pp)
-      {
-        oyProfile_s * web = oyProfile_FromStd( oyASSUMED_WEB,
-                                               icc_profile_flags, 0 );
-        output->cc.dst_profile = oyProfile_FromMem( size, pp, 0,0 );
-        if(oyProfile_Equal( web, output->cc.dst_profile ))
-          oyProfile_Release( &output->cc.dst_profile );
-        oyProfile_Release( &web );
-      } else
-      oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                      DBG_STRING "no normal profile on %s, size: %d",
-                      DBG_ARGS, output->name, (int)size);
-    }
-    if(pp)
-    { XFree(pp); pp = NULL; }
+/**
+ * CLUT builds and profile lookups run in a small pool of worker threads.
+ * Workers take jobs from a queue and touch only Oyranos and the memory of
+ * their job, which holds a copy of the context. Finished jobs are pushed
+ * onto a lock-free list and announced through an eventfd, which compiz
+ * watches. drainJobs() then completes them on the compositor thread, where
+ * GL and compiz state are safe to use. Without threads the jobs run in place.
+ *
+ * A cancelled job is dropped from the queue, or stops at its next check of
+ * cancelled and is discarded after it finished. So freeing a context never
+ * waits for a worker.
+ */
+#define WORKERS_MAX 4
+
+#define JOB_QUEUED   0
+#define JOB_RUNNING  1
+
+/* Colour work is ranked by what the user sees. Workers take the best
+ * ranked job, uploads go out in the same order. */
+#define PRIORITY_OUTPUT      0       /* outputs with visible area */
+#define PRIORITY_FOCUS       1       /* regions of the focused window */
+#define PRIORITY_VISIBLE     2       /* regions of other visible windows */
+#define PRIORITY_BACKGROUND  3       /* hidden windows, disabled outputs */
+#define PRIORITIES           4
+
+struct PrivJob {
+  PrivJob * next;                    /* in the queue or the finished list */
+  void (* run)( PrivJob * job );     /* on a worker */
+  void (* done)( PrivJob * job );    /* on the compositor thread */
+  int state;                         /* guarded by the pool mutex */
+  int priority;                      /* queue; guarded by the pool mutex */
+  int cancelled;                     /* atomic; stop and skip done() */
+  CompScreen * s;
+  PrivColorContext * cc;
+  unsigned int generation;           /* of cc at submit time */
+  PrivColorContext work;             /* the workers copy of cc */
+  int advanced;
+  int clut;                          /* setupColourTable() */
+  /* output jobs */
+  PrivColorOutput * output;
+  unsigned long i;
+  char name[32];
+  uint8_t id[16];
+  int identified;
+  oyConfig_s * device;
+  CompBool init;
+  int build;                         /* colour_desktop_can at submit time */
+  int error;                         /* getDeviceProfile() */
+  uint8_t transform_md5[16];         /* before the update */
+  XRectangle xRect;                  /* before the update */
+  /* warm up job */
+  long usec;
+};
 
-    if(output->cc.dst_profile)
-    {
-      oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                      DBG_STRING "reusing existing profile on %s, size: %d",
-                      DBG_ARGS, output->name, (int)size);
-    } else
+static struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t wake;               /* queued work or quit */
+  pthread_t threads[WORKERS_MAX];
+  int nThreads;
+  int started;                       /* startWorkers() was tried */
+  int quit;
+  PrivJob * head[PRIORITIES],        /* queued jobs per priority */
+          * tail[PRIORITIES];
+  PrivJob * completed;               /* finished jobs, lock-free LIFO */
+  int efd;
+  CompWatchFdHandle watch;
+} worker_pool = {
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+  .wake = PTHREAD_COND_INITIALIZER,
+  .efd = -1
+};
+
+/**
+ * Rank a context by its visibility. Called on the compositor thread only.
+ */
+static int colourPriority( CompScreen *s, PrivColorContext *ccontext )
+{
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
+  CompWindow * w;
+
+  /* the Oyranos warm up comes first */
+  if(!ccontext)
+    return PRIORITY_OUTPUT;
+
+  if(!ccontext->window)
+  {
+    if(ccontext->output >= 0 && ccontext->output < (int)ps->nContexts &&
+       ps->draw[ccontext->output].xRect.width &&
+       ps->draw[ccontext->output].xRect.height)
+      return PRIORITY_OUTPUT;
+    return PRIORITY_BACKGROUND;
+  }
+
+  w = findWindowAtScreen( s, ccontext->window );
+  if(!w || WINDOW_INVISIBLE(w) || w->shaded ||
+     (w->state & CompWindowStateHiddenMask))
+    return PRIORITY_BACKGROUND;
+  if(ccontext->window == s->display->activeWindow)
+    return PRIORITY_FOCUS;
+  return PRIORITY_VISIBLE;
+}
+
+/* pool mutex held */
+static void queueJob( PrivJob * job )
+{
+  int p = job->priority;
+
+  job->state = JOB_QUEUED;
+  job->next = NULL;
+  if(worker_pool.tail[p])
+    worker_pool.tail[p]->next = job;
+  else
+    worker_pool.head[p] = job;
+  worker_pool.tail[p] = job;
+}
+
+/* pool mutex held; returns 1, when job was queued */
+static int unlinkJob( PrivJob * job )
+{
+  int p = job->priority;
+  PrivJob ** j = &worker_pool.head[p], * prev = NULL;
+
+  if(job->state != JOB_QUEUED)
+    return 0;
+
+  while(*j && *j != job)
+  {
+    prev = *j;
+    j = &(*j)->next;
+  }
+  if(!*j)
+    return 0;
+
+  *j = job->next;
+  if(worker_pool.tail[p] == job)
+    worker_pool.tail[p] = prev;
+  return 1;
+}
+
+/* pool mutex held */
+static PrivJob * nextJob( void )
+{
+  for(int p = 0; p < PRIORITIES; ++p)
+  {
+    PrivJob * job = worker_pool.head[p];
+    if(!job)
+      continue;
+
+    worker_pool.head[p] = job->next;
+    if(!worker_pool.head[p])
+      worker_pool.tail[p] = NULL;
+    return job;
+  }
+  return NULL;
+}
+
+/**
+ * Rank the queued jobs again after focus or visibility changed.
+ */
+static void reprioritiseJobs( CompDisplay * d )
+{
+  PrivJob * moved = NULL;
+
+  if(!worker_pool.nThreads)
+    return;
+
+  pthread_mutex_lock( &worker_pool.mutex );
+  for(int p = 0; p < PRIORITIES; ++p)
+  {
+    PrivJob * job = worker_pool.head[p], * next;
+    while(job)
     {
-      oyOptions_s * options = 0;
-      oyOptions_SetFromString( &options,
-                   "//" OY_TYPE_STD "/config/command",
-                                       "list", OY_CREATE_NEW );
-      oyOptions_SetFromInt( &options,
-                            "////icc_profile_flags",
-                            icc_profile_flags, 0, OY_CREATE_NEW );
-      oyOptions_SetFromString( &options,
-                   "//" OY_TYPE_STD "/config/icc_profile.x_color_region_target",
-                                       "yes", OY_CREATE_NEW );
-      t_err = oyDeviceAskProfile2( device, options, &output->cc.dst_profile );
-      if(t_err)
-        oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                      DBG_STRING "oyDeviceAskProfile2() returned an issue %s: %d",
-                      DBG_ARGS, output->name, t_err);
-      if(!output->cc.dst_profile || t_err == -1)
+      int priority;
+
+      next = job->next;
+      priority = job->s->display == d ? colourPriority( job->s, job->cc ) : p;
+      if(priority != p)
       {
-        int old_t_err = t_err;
-        t_err = oyDeviceGetProfile( device, options, &output->cc.dst_profile );
-        oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                      DBG_STRING "oyDeviceAskProfile2() has \"%s\" profile on %s: %d oyDeviceGetProfile() got -> \"%s\" %d",
-                      DBG_ARGS, output->cc.dst_profile ? oyProfile_GetText(output->cc.dst_profile, oyNAME_DESCRIPTION):"----",
-                      output->name, old_t_err, oyProfile_GetText(output->cc.dst_profile, oyNAME_DESCRIPTION), t_err);
+        unlinkJob( job );
+        job->priority = priority;
+        job->next = moved;
+        moved = job;
       }
-      oyOptions_Release( &options );
+      job = next;
     }
+  }
+  while(moved)
+  {
+    PrivJob * next = moved->next;
+    queueJob( moved );
+    moved = next;
+  }
+  pthread_mutex_unlock( &worker_pool.mutex );
+}
 
-    if(output->cc.dst_profile)
-    {
-      /* check that no sRGB is delivered */
-      if(t_err)
-      {
-        oyProfile_s * web = oyProfile_FromStd( oyASSUMED_WEB, icc_profile_flags, 0 );
-        if(oyProfile_Equal( web, output->cc.dst_profile ))
-        {
-          oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                      DBG_STRING "Output %s ignoring sRGB fallback %d %d",
-                      DBG_ARGS, output->name, error, t_err);
-          oyProfile_Release( &output->cc.dst_profile );
-          error = 1;
-        }
-        oyProfile_Release( &web );
-      }
-    } else
+static int jobCancelled( const int * cancelled )
+{
+  return cancelled && __atomic_load_n( cancelled, __ATOMIC_RELAXED );
+}
+
+static void * workerThread( void * data OY_UNUSED )
+{
+  pthread_mutex_lock( &worker_pool.mutex );
+  for(;;)
+  {
+    PrivJob * job;
+    uint64_t one = 1;
+
+    while(!worker_pool.quit && !(job = nextJob()))
+      pthread_cond_wait( &worker_pool.wake, &worker_pool.mutex );
+    if(worker_pool.quit)
+      break;
+
+    job->state = JOB_RUNNING;
+    pthread_mutex_unlock( &worker_pool.mutex );
+
+    /* wait for a Oyranos initialisation in an other worker */
+    if(!jobCancelled( &job->cancelled ))
+      iccProfileFlags();
+    if(!jobCancelled( &job->cancelled ))
+      job->run( job );
+
+    /* push without the lock; the compositor takes the whole list */
+    job->next = __atomic_load_n( &worker_pool.completed, __ATOMIC_RELAXED );
+    while(!__atomic_compare_exchange_n( &worker_pool.completed, &job->next, job,
+                                        1, __ATOMIC_RELEASE, __ATOMIC_RELAXED ))
+      ;
+    if(write( worker_pool.efd, &one, sizeof(one) ) != sizeof(one))
+      fprintf( stderr, DBG_STRING"eventfd write failed\n", DBG_ARGS );
+
+    pthread_mutex_lock( &worker_pool.mutex );
+  }
+  pthread_mutex_unlock( &worker_pool.mutex );
+
+  return NULL;
+}
+
+static void freeJob( PrivJob * job )
+{
+  oyConfig_Release( &job->device );
+  oyProfile_Release( &job->work.src_profile );
+  oyProfile_Release( &job->work.dst_profile );
+  if(job->work.output_name)
+    free( job->work.output_name );
+  if(job->work.clut)
+    cicc_free( job->work.clut );
+  cacheRelease( &job->work.cache );
+  cicc_free( job );
+}
+
+/**
+ * Complete a job on the compositor thread.
+ */
+static void finishJob( PrivJob * job )
+{
+  if(!job->cc)
+  {
+    if(!jobCancelled( &job->cancelled ))
+      job->done( job );
+  } else
+  if(!jobCancelled( &job->cancelled ) &&
+     job->generation == job->cc->generation)
+  {
+    PrivScreen * ps = compObjectGetPrivate((CompObject *) job->s);
+    PrivColorContext * cc = job->cc;
+    oyProfile_s * dst_profile = cc->dst_profile;
+
+    /* take over the result; the old memory goes with the job */
+    cc->dst_profile = job->work.dst_profile;
+    job->work.dst_profile = dst_profile;
+    memcpy( cc->transform_md5, job->work.transform_md5, 16 );
+    if(job->clut == 0)
     {
-      oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
-                      DBG_STRING "Output %s: no ICC profile found %d",
-                      DBG_ARGS, output->name, error);
-      error = 1;
+      GLushort (*clut)[GRIDPOINTS][GRIDPOINTS][3] = cc->clut;
+      PrivCacheEntry * cache = cc->cache;
+      cc->clut = job->work.clut;
+      job->work.clut = clut;
+      cc->cache = job->work.cache;
+      job->work.cache = cache;
     }
 
-  return error;
+    cc->job = NULL;
+    --ps->nJobs;
+    job->done( job );
+  }
+  freeJob( job );
 }
 
-typedef struct pcc_s {
-  PrivColorContext * ccontext;
-  int advanced;
-  CompScreen * screen;
-} pcc_t;
-
-static void * setupColourTable_cb( void * data )
+/**
+ * compAddWatchFd() callback: complete all finished jobs.
+ */
+static Bool drainJobs( void * closure OY_UNUSED )
 {
-  pcc_t * d = (pcc_t*)data;
+  uint64_t count;
+  PrivJob * list, * fifo = NULL;
 
-  setupColourTable( d->ccontext, d->advanced, d->screen );
-  updateOutputConfiguration( d->screen, FALSE, -1 );
+  if(read( worker_pool.efd, &count, sizeof(count) ) < 0 && errno != EAGAIN)
+    fprintf( stderr, DBG_STRING"eventfd read failed\n", DBG_ARGS );
 
-  return NULL;
+  list = __atomic_exchange_n( &worker_pool.completed, NULL, __ATOMIC_ACQUIRE );
+
+  /* complete in the order of finishing */
+  while(list)
+  {
+    PrivJob * next = list->next;
+    list->next = fifo;
+    fifo = list;
+    list = next;
+  }
+  while(fifo)
+  {
+    PrivJob * next = fifo->next;
+    finishJob( fifo );
+    fifo = next;
+  }
+
+  return TRUE;
 }
-static void iccProgressCallback (    double              progress_zero_till_one,
-                                     char              * status_text OY_UNUSED,
-                                     int                 thread_id_,
-                                     int                 job_id,
-                                     oyStruct_s        * cb_progress_context )
+
+static void startWorkers( void )
 {
-  oyPointer_s * context = (oyPointer_s *) cb_progress_context;
-  pcc_t * pcontext = (pcc_t*) oyPointer_GetPointer( context );
-  printf( "%s() job_id: %d thread: %d %g\n", __func__, job_id, thread_id_,
-          progress_zero_till_one );
-  if(progress_zero_till_one >= 1.0)
+  long cpus = sysconf( _SC_NPROCESSORS_ONLN );
+  int n = cpus > 1 ? cpus - 1 : 1;
+
+  worker_pool.started = 1;
+  if(n > WORKERS_MAX)
+    n = WORKERS_MAX;
+
+  worker_pool.efd = eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC );
+  if(worker_pool.efd < 0)
   {
-    setupColourTable_cb( pcontext );
-    free(pcontext);
+    fprintf( stderr, DBG_STRING"no eventfd, running jobs in place\n", DBG_ARGS );
+    return;
   }
+  worker_pool.watch = compAddWatchFd( worker_pool.efd, POLLIN, drainJobs, NULL );
+
+  for(int i = 0; i < n; ++i)
+    if(pthread_create( &worker_pool.threads[worker_pool.nThreads], NULL,
+                       workerThread, NULL ) == 0)
+      ++worker_pool.nThreads;
 }
 
+static void stopWorkers( void )
+{
+  pthread_mutex_lock( &worker_pool.mutex );
+  worker_pool.quit = 1;
+  pthread_cond_broadcast( &worker_pool.wake );
+  pthread_mutex_unlock( &worker_pool.mutex );
+
+  for(int i = 0; i < worker_pool.nThreads; ++i)
+    pthread_join( worker_pool.threads[i], NULL );
+  worker_pool.nThreads = 0;
 
-static void    setupColourTable      ( PrivColorContext  * ccontext,
-                                       int                 advanced,
-                                       CompScreen        * s )
+  if(worker_pool.efd >= 0)
+  {
+    /* only cancelled jobs are left after the screens are gone */
+    drainJobs( NULL );
+    compRemoveWatchFd( worker_pool.watch );
+    close( worker_pool.efd );
+  }
+  worker_pool.efd = -1;
+  worker_pool.watch = 0;
+  worker_pool.started = worker_pool.quit = 0;
+}
+
+static PrivJob * newJob              ( CompScreen        * s,
+                                       PrivColorContext  * ccontext,
+                                       void             (* run)( PrivJob * ),
+                                       void             (* done)( PrivJob * ) )
 {
-  oyConversion_s * cc;
-  int error = 0;
-  oyProfile_s * dst_profile = ccontext->dst_profile, * web = 0;
+  PrivJob * job = cicc_alloc( sizeof(PrivJob) );
 
-    if(!ccontext->dst_profile)
-      dst_profile = web = oyProfile_FromStd( oyASSUMED_WEB, icc_profile_flags, 0 );
+  if(!job)
+    return NULL;
 
-    {
-      int flags = 0;
-      int ** ptr;
+  job->s = s;
+  job->cc = ccontext;
+  job->run = run;
+  job->done = done;
+  job->clut = 1;
 
-      oyProfile_s * src_profile = ccontext->src_profile;
-      oyOptions_s * options = 0;
+  return job;
+}
 
-      oyPixel_t pixel_layout = OY_TYPE_123_16;
-      oyCompLogMessage(NULL, "compicc", CompLogLevelDebug,
-             DBG_STRING "%s -> %s",
-             DBG_ARGS, oyProfile_GetText( src_profile, oyNAME_DESCRIPTION ),
-                       oyProfile_GetText( dst_profile, oyNAME_DESCRIPTION ) );
+/**
+ * Hand a job to the workers. The context belongs to the job until it is
+ * completed or cancelled; a queued upload of the old CLUT is dropped.
+ * Jobs without context are not counted in PrivScreen::nJobs.
+ */
+static void    submitJob             ( PrivJob           * job )
+{
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) job->s);
 
-      /* skip web to web conversion */
-      if(oyProfile_Equal( src_profile, web ))
-      {
-        oyCompLogMessage(NULL, "compicc", CompLogLevelDebug,
-             DBG_STRING "src_profile == web",
-             DBG_ARGS );
-        goto clean_setupColourTable;
-      }
+  if(!worker_pool.started)
+    startWorkers();
 
-      if(!src_profile)
-        src_profile = oyProfile_FromStd( oyASSUMED_WEB, icc_profile_flags, 0 );
+  if(job->cc)
+  {
+    if(job->cc->job)
+      cancelJob( job->cc->job );
+    unqueueUpload( ps, job->cc );
+
+    job->generation = job->cc->generation;
+    job->work.src_profile = oyProfile_Copy( job->cc->src_profile, 0 );
+    job->work.dst_profile = oyProfile_Copy( job->cc->dst_profile, 0 );
+    job->work.output_name = job->cc->output_name ?
+                            strdup( job->cc->output_name ) : NULL;
+    job->work.output = job->cc->output;
+    job->work.window = job->cc->window;
+
+    job->cc->job = job;
+    ++ps->nJobs;
+    if(job->output)
+      ++ps->nOutputJobs;
+  }
 
-      if(!src_profile)
-        oyCompLogMessage(NULL, "compicc", CompLogLevelWarn,
-             DBG_STRING "Output %s: no oyASSUMED_WEB src_profile",
-             DBG_ARGS, ccontext->output_name );
+  if(!worker_pool.nThreads)
+  {
+    job->run( job );
+    finishJob( job );
+    return;
+  }
 
-      /* optionally set advanced options from Oyranos */
-      if(advanced)
-        flags = oyOPTIONATTRIBUTE_ADVANCED;
+  job->priority = colourPriority( job->s, job->cc );
 
-      oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
-                      DBG_STRING "oyConversion_Correct(///icc_color,%d,0) %s %s",
-                      DBG_ARGS, flags, ccontext->output_name,
-                      advanced?"advanced":"");
-      oyImage_s * image_in = oyImage_Create( GRIDPOINTS,GRIDPOINTS*GRIDPOINTS,
-                                             ccontext->clut,
-                                             pixel_layout, src_profile, 0 );
-      oyImage_s * image_out= oyImage_Create( GRIDPOINTS,GRIDPOINTS*GRIDPOINTS,
-                                             ccontext->clut,
-                                             pixel_layout, dst_profile, 0 );
+  pthread_mutex_lock( &worker_pool.mutex );
+  queueJob( job );
+  pthread_cond_signal( &worker_pool.wake );
+  pthread_mutex_unlock( &worker_pool.mutex );
+}
 
-      oyProfile_Release( &src_profile );
-
-      oyJob_s * job = oyJob_New(0);
-      job->cb_progress = iccProgressCallback;
-      oyPointer_s * oy_ptr = oyPointer_New(0);
-      pcc_t * pcc   = calloc( sizeof(pcc_t), 1 );
-      pcc->ccontext = ccontext;
-      pcc->advanced = advanced;
-      pcc->screen = s;
-      oyPointer_Set( oy_ptr,
-                     __FILE__,
-                     "struct pcc_s*",
-                     pcc, 0, 0 );
-      job->cb_progress_context = (oyStruct_s*) oyPointer_Copy( oy_ptr, 0 );
-      oyOptions_MoveInStruct( &options, OY_BEHAVIOUR_STD "/expensive_callback", (oyStruct_s**)&job, OY_CREATE_NEW );
-      /* wait no longer than approximately 1 seconds */
-      oyOptions_SetFromString( &options, OY_BEHAVIOUR_STD "/expensive", "10", OY_CREATE_NEW );
-      cc = oyConversion_CreateBasicPixels( image_in, image_out, options, 0 );
-      if (cc == NULL)
-      {
-        oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
-                      DBG_STRING "no conversion created for %s",
-                      DBG_ARGS, ccontext->output_name);
-        goto clean_setupColourTable;
-      }
-      oyOptions_Release( &options );
+/**
+ * Detach a job from its context and make its result stale. A queued job is
+ * dropped, a running one stops at the next check.
+ */
+static void    cancelJob             ( PrivJob           * job )
+{
+  PrivScreen * ps;
+  int queued = 0;
 
-      error = oyOptions_SetFromString( &options,
-                                     "//" OY_TYPE_STD "/config/display_mode", "1",
-                                     OY_CREATE_NEW );
-      error = oyConversion_Correct(cc, "//" OY_TYPE_STD "/icc_color", flags, options);
-      if(error)
-      {
-        oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
-                      DBG_STRING "oyConversion_Correct(///icc_color,%d,0) failed %s",
-                      DBG_ARGS, flags, ccontext->output_name);
-        goto clean_setupColourTable;
-      }
-      oyOptions_Release( &options );
+  if(!job)
+    return;
 
+  ps = compObjectGetPrivate((CompObject *) job->s);
+  if(job->cc)
+  {
+    job->cc->job = NULL;
+    ++job->cc->generation;
+    --ps->nJobs;
+    if(job->output)
+      --ps->nOutputJobs;
+  }
 
-      oyFilterGraph_s * cc_graph = oyConversion_GetGraph( cc );
-      oyFilterNode_s * icc = oyFilterGraph_GetNode( cc_graph, -1, "///icc_color", 0 );
+  pthread_mutex_lock( &worker_pool.mutex );
+  queued = unlinkJob( job );
+  __atomic_store_n( &job->cancelled, 1, __ATOMIC_RELAXED );
+  pthread_mutex_unlock( &worker_pool.mutex );
 
-      uint32_t exact_hash_size = 0;
-      char * hash_text = 0;
-      const char * t = 0;
-      {
-        t = oyFilterNode_GetText( icc, oyNAME_NAME );
-        if(t)
-          hash_text = strdup(t);
-      }
-      oyHash_s * entry;
-      oyArray2d_s * clut = NULL;
-      oyStructList_s * cache = pluginGetPrivatesCache();
-      entry = oyStructList_GetHash( cache, exact_hash_size, hash_text );
-      clut = (oyArray2d_s*) oyHash_GetPointer( entry, oyOBJECT_ARRAY2D_S);
-      oyFilterNode_Release( &icc );
-      oyFilterGraph_Release( &cc_graph );
+  /* running jobs are freed by drainJobs() */
+  if(queued)
+    freeJob( job );
+}
 
-      oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
-                      DBG_STRING "clut from cache %s %s",
-                      DBG_ARGS, clut?"obtained":"no", hash_text );
-      if(clut)
-      {
-        ptr = (int**)oyArray2d_GetData(clut);
-        memcpy( ccontext->clut, ptr[0], 
-                sizeof(GLushort) * GRIDPOINTS*GRIDPOINTS*GRIDPOINTS * 3 );
-      } else
-      {
-        oyBlob_s * blob = icc ? oyFilterNode_ToBlob( icc, NULL ) : NULL;
+/**
+ * Damage a window relative region.
+ */
+static void damageWindowRegion( CompWindow * w, const PrivRegion * r )
+{
+  const BOX * b = REGION_BOXES(r);
 
-        if(!blob)
-        {
-          oyConversion_Release( &cc );
-          oyFilterNode_Release( &icc );
+  for(int i = 0; i < r->nBoxes; ++i)
+  {
+    BOX box = b[i];
+    addWindowDamageRect( w, &box );
+  }
+}
 
-          oyOptions_SetFromString( &options, OY_DEFAULT_CMM_CONTEXT, "lcm2",
-                               OY_CREATE_NEW );
-          cc = oyConversion_CreateBasicPixels( image_in, image_out, options, 0 );
-          if (cc == NULL)
-          {
-            oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
-                      DBG_STRING "no conversion created for %s",
-                      DBG_ARGS, ccontext->output_name);
-            goto clean_setupColourTable;
-          }
-          oyOptions_Release( &options );
-          error = oyOptions_SetFromString( &options,
-                                     "//"OY_TYPE_STD"/config/display_mode", "1",
-                                     OY_CREATE_NEW );
-          error = oyConversion_Correct(cc, "//" OY_TYPE_STD "/icc_color", flags, options);
-          icc = cc_graph ? oyFilterGraph_GetNode( cc_graph, -1, "///icc_color", 0 ) : NULL;
-          blob = icc ? oyFilterNode_ToBlob( icc, NULL ) : NULL;
-          oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
-                      DBG_STRING "created %s",
-                      DBG_ARGS, t );
-        }
+static void freeRegionContexts( PrivScreen * ps, PrivColorRegion * r )
+{
+  if(!r->cc)
+    return;
 
-        if(oy_debug)
-        {
-          oyOptions_s * node_opts = oyFilterNode_GetOptions( icc, 0 );
+  for(unsigned long j = 0; j < r->nCc; ++j)
+  {
+    if(r->cc[j])
+    {
+      cancelJob( r->cc[j]->job );
+      unqueueUpload( ps, r->cc[j] );
+      oyProfile_Release( &r->cc[j]->dst_profile );
+      oyProfile_Release( &r->cc[j]->src_profile );
+      if(r->cc[j]->texture->glTexture)
+        glDeleteTextures( 1, &r->cc[j]->texture->glTexture );
+      if(r->cc[j]->output_name)
+        free( r->cc[j]->output_name );
+      if(r->cc[j]->clut)
+        cicc_free( r->cc[j]->clut );
+      cacheRelease( &r->cc[j]->cache );
+      cicc_free( r->cc[j] );
+      r->cc[j] = NULL;
+    }
+    else
+      break;
+  }
+  cicc_free( r->cc ); r->cc = 0;
+  r->nCc = 0;
+}
+
+/**
+ * Create the colour contexts of a region for each output.
+ */
+static void regionJobRun( PrivJob * job )
+{
+  job->clut = setupColourTable( &job->work, job->advanced, &job->cancelled );
+}
+
+static void regionJobDone( PrivJob * job )
+{
+  if(job->clut == 0)
+    queueUpload( job->s, job->cc );
+}
+
+/**
+ * Build the CLUT of a region context in the worker pool.
+ */
+static void buildRegionContext( CompScreen * s, PrivColorContext * cc, int advanced )
+{
+  PrivJob * job;
+
+  if(!cc->dst_profile || !cc->src_profile)
+    return;
+
+  job = newJob( s, cc, regionJobRun, regionJobDone );
+  if(!job)
+    return;
+  job->advanced = advanced;
+  submitJob( job );
+}
+
+static int setupRegionContexts( CompWindow * w, PrivColorRegion * r )
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) w->screen);
+  int advanced = getDisplayAdvanced( w->screen, 0 );
+
+  r->cc = (PrivColorContext**)cicc_alloc( (ps->nContexts + 1) *
+                                          sizeof(PrivColorContext*));
+  if(!r->cc)
+  {
+    printf( DBG_STRING "Could not allocate contexts. Stop!\n",
+            DBG_ARGS );
+    return 1;
+  }
+  r->nCc = ps->nContexts;
+
+  for(unsigned long j = 0; j < ps->nContexts; ++j)
+  {
+    r->cc[j] = (PrivColorContext*) cicc_alloc( sizeof(PrivColorContext) );
+
+    if(!r->cc[j])
+    {
+      printf( DBG_STRING "Could not allocate context. Stop!\n",
+              DBG_ARGS );
+      return 1;
+    }
+    r->cc[j]->texture = &r->cc[j]->region_texture;
+    r->cc[j]->output = j;
+    r->cc[j]->window = w->id;
+    r->cc[j]->output_name = strdup( ps->contexts[j].cc.output_name ?
+                                    ps->contexts[j].cc.output_name : "" );
+
+    r->cc[j]->src_profile = profileFromMD5(r->md5);
+    if(!r->cc[j]->src_profile)
+    {
+      printf( DBG_STRING "region on %lu has no source profile!\n",
+              DBG_ARGS, j );
+      continue;
+    }
+    fprintf( stderr, DBG_STRING"region->md5: %s\n", DBG_ARGS,
+             oyProfile_GetText( r->cc[j]->src_profile, oyNAME_DESCRIPTION ) );
+
+    /* a busy output passes its profile on in outputJobDone() */
+    if(!ps->contexts[j].cc.job)
+      r->cc[j]->dst_profile = oyProfile_Copy( ps->contexts[j].cc.dst_profile, 0 );
+
+    if(!r->cc[j]->dst_profile)
+    {
+      printf( DBG_STRING "output %lu not ready\n",
+              DBG_ARGS, j );
+      continue;
+    }
+
+    buildRegionContext( w->screen, r->cc[j], advanced );
+  }
+
+  return 0;
+}
+
+/**
+ * Called when new regions have been attached to a window. Fetches these and
+ * saves them in the local list.
+ * The property bytes, the referenced XFixes regions and the window size are
+ * hashed. Nothing is done, when they are equal to the applied state.
+ * Otherwise the new list is compared to the old one by XserverRegion and
+ * MD5. Unchanged regions keep their colour contexts and only changed
+ * geometry is damaged.
+ *
+ * @return                             - 0  unchanged
+ *                                     - 1  regions updated
+ *                                     - -1 out of memory, nothing changed
+ */
+static int updateWindowRegions(CompWindow *w)
+{
+  PrivWindow *pw = compObjectGetPrivate((CompObject *) w);
+
+  CompDisplay *d = w->screen->display;
+  PrivDisplay *pd = compObjectGetPrivate((CompObject *) d);
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) w->screen);
+  PrivRegion * fetched = NULL;
+  unsigned char * blob, * p;
+  size_t blob_size;
+  uint8_t hash[16];
+  int size[2] = { w->serverWidth, w->serverHeight };
+  int status = 1;
+
+  /* fetch the regions */
+  unsigned long nBytes = 0;
+  void *data = fetchProperty( d->display, w->id, pd->iccColorRegions,
+                              XA_CARDINAL, &nBytes, False );
+
+  /* allocate the list */
+  unsigned long count = 1;
+  if(data)
+    count += XcolorRegionCount(data, nBytes + 1);
+
+  if(oy_debug)
+  fprintf( stderr, DBG_STRING"XcolorRegionCount+1=%lu\n", DBG_ARGS,
+           count );
+
+  fetched = (PrivRegion*) cicc_alloc( count * sizeof(PrivRegion) );
+  if(!fetched)
+  {
+    XFree(data);
+    return -1;
+  }
+
+  /* dereference the application regions */
+  XcolorRegion *region = data;
+  blob_size = sizeof(size) + (count - 1) * sizeof(XcolorRegion);
+  for (unsigned long i = 0; i < (count - 1); ++i)
+  {
+    convertRegion( d->display, ntohl(region->region), &fetched[i] );
+    blob_size += sizeof(int) + fetched[i].nBoxes * sizeof(BOX);
+    region = XcolorRegionNext(region);
+  }
+
+  /* hash them with the property and the window size */
+  p = blob = cicc_alloc( blob_size );
+  if(!blob)
+  {
+    for (unsigned long i = 0; i < (count - 1); ++i)
+      regionFini( &fetched[i] );
+    cicc_free( fetched );
+    XFree(data);
+    return -1;
+  }
+  memcpy( p, size, sizeof(size) ); p += sizeof(size);
+  if(data)
+  {
+    memcpy( p, data, (count - 1) * sizeof(XcolorRegion) );
+    p += (count - 1) * sizeof(XcolorRegion);
+  }
+  for (unsigned long i = 0; i < (count - 1); ++i)
+  {
+    memcpy( p, &fetched[i].nBoxes, sizeof(int) ); p += sizeof(int);
+    memcpy( p, REGION_BOXES(&fetched[i]), fetched[i].nBoxes * sizeof(BOX) );
+    p += fetched[i].nBoxes * sizeof(BOX);
+  }
+  oyMiscBlobGetMD5_( blob, blob_size, hash );
+  cicc_free( blob );
+
+  if(pw->active && pw->nRegions && memcmp( hash, pw->regions_md5, 16 ) == 0)
+  {
+    for (unsigned long i = 0; i < (count - 1); ++i)
+      regionFini( &fetched[i] );
+    cicc_free( fetched );
+    XFree(data);
+    return 0;
+  }
+  memcpy( pw->regions_md5, hash, 16 );
+
+  /* keep the old list for comparison */
+  PrivColorRegion * old = pw->pRegion;
+  unsigned long nOld = pw->nRegions;
+  int resized = !nOld || !pw->absoluteWindowRectangleOld ||
+                oyRectangle_GetGeo1( pw->absoluteWindowRectangleOld, 2 ) != w->serverWidth ||
+                oyRectangle_GetGeo1( pw->absoluteWindowRectangleOld, 3 ) != w->serverHeight;
+
+  pw->pRegion = (PrivColorRegion*) cicc_alloc(count * sizeof(PrivColorRegion));
+  if (pw->pRegion == NULL)
+  {
+    pw->pRegion = old;
+    memset( pw->regions_md5, 0, 16 );
+    status = -1;
+    goto out;
+  }
+  pw->nRegions = 0;
+  oyRectangle_Release( &pw->absoluteWindowRectangleOld );
+
+  /* get the complete windows region and put it at the end */
+  windowRegion( w, &pw->pRegion[count-1].region );
+
+
+  /* fill in the possible application region(s) */
+  region = data;
+  PrivRegion * wRegion = &pw->pRegion[count-1].region;
+  for (unsigned long i = 0; i < (count - 1); ++i)
+  {
+    PrivColorRegion * r = &pw->pRegion[i];
+    uint8_t n[] = {0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0};
+    r->id = ntohl(region->region);
+    r->region = fetched[i];
+    regionInit( &fetched[i] );
+    memcpy( r->md5, region->md5, 16 );
+
+    /* substract a application region from the window region */
+    regionSubtract( wRegion, &r->region );
+
+    /* reuse a unchanged region with its colour contexts */
+    unsigned long k;
+    for(k = 0; nOld && k < nOld - 1; ++k)
+      if(r->id != None && old[k].id == r->id &&
+         memcmp( old[k].md5, r->md5, 16 ) == 0 &&
+         old[k].nCc == ps->nContexts)
+        break;
+    if(nOld && k < nOld - 1)
+    {
+      r->cc = old[k].cc;
+      r->nCc = old[k].nCc;
+      old[k].cc = NULL;
+      old[k].id = None;
+      if(!regionEqual( &old[k].region, &r->region ))
+      {
+        damageWindowRegion( w, &old[k].region );
+        damageWindowRegion( w, &r->region );
+      }
+    } else
+    {
+      damageWindowRegion( w, &r->region );
+      if(memcmp(region->md5,n,16) != 0)
+        setupRegionContexts( w, r );
+      else if(oy_debug)
+        fprintf( stderr, DBG_STRING"no region->md5 %lu cc=0x%lx %d,%d,%dx%d\n", DBG_ARGS,
+                 i, (unsigned long)r->cc, r->region.extents.x1,
+                 r->region.extents.y1,
+                 r->region.extents.x2-r->region.extents.x1,
+                 r->region.extents.y2-r->region.extents.y1
+ );
+    }
+
+    region = XcolorRegionNext(region);
+  }
+
+  /* release removed or modified regions */
+  for (unsigned long k = 0; k < nOld; ++k)
+  {
+    if(k < nOld - 1 && old[k].id != None)
+      damageWindowRegion( w, &old[k].region );
+    freeRegionContexts( ps, &old[k] );
+    regionFini( &old[k].region );
+  }
+  if (nOld)
+    cicc_free(old);
+
+  pw->nRegions = count;
+  pw->active = 1;
+
+  pw->absoluteWindowRectangleOld = oyRectangle_NewWith( 0, 0, w->serverWidth,
+                                                        w->serverHeight, 0 );
+
+  if(resized)
+    addWindowDamage(w);
+
+out:
+  for (unsigned long i = 0; i < (count - 1); ++i)
+    regionFini( &fetched[i] );
+  cicc_free( fetched );
+  XFree(data);
+#if defined(PLUGIN_DEBUG_)
+  if(count > 1)
+  oyCompLogMessage(d, "compicc", CompLogLevelDebug, "Added %d regions",
+		      count);
+#endif
+
+  return status;
+}
+
+
+/**
+ * Called when the window target (_ICC_COLOR_TARGET) has been changed.
+ */
+static void updateWindowOutput(CompWindow *w)
+{
+  PrivWindow *pw = compObjectGetPrivate((CompObject *) w);
+
+  CompDisplay *d = w->screen->display;
+  PrivDisplay *pd = compObjectGetPrivate((CompObject *) d);
+
+  if (pw->output)
+    XFree(pw->output);
+
+  unsigned long nBytes;
+  pw->output = fetchProperty(d->display, w->id, pd->iccColorOutputs, XA_STRING, &nBytes, False);
+
+  if(!pw->nRegions)
+    addWindowDamage(w);
+}
+
+/**
+ * Upload the CLUT into a new texture. The previous texture stays in use
+ * until the new one is complete.
+ */
+static void cdCreateTexture( PrivColorContext *ccontext )
+{
+    PrivColorTexture * t = ccontext->texture;
+    GLuint old = t->glTexture,
+           texture = 0;
+    const void * clut = ccontext->clut ? (const void*) ccontext->clut :
+                        ccontext->cache ? (const void*) ccontext->cache->clut :
+                        NULL;
+
+    if(!clut)
+      return;
+
+    t->scale = (GLfloat) (GRIDPOINTS - 1) / GRIDPOINTS;
+    t->offset = (GLfloat) 1.0 / (2 * GRIDPOINTS);
+
+
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_3D, texture);
+
+    fprintf( stderr, DBG_STRING"glTexture=%d\n", DBG_ARGS,
+             texture );
+
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+    glTexImage3D( GL_TEXTURE_3D, 0, GL_RGB16, GRIDPOINTS,GRIDPOINTS,GRIDPOINTS,
+                  0, GL_RGB, GL_UNSIGNED_SHORT, clut);
+    glBindTexture(GL_TEXTURE_3D, 0);
+
+    t->glTexture = texture;
+    if(old)
+      glDeleteTextures( 1, &old );
+    ccontext->upload_pending = 0;
+}
+
+/**
+ * Repaint, where a context is used.
+ */
+static void damageColorContext( CompScreen *s, PrivColorContext *ccontext )
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
+
+  if(ccontext->window)
+  {
+    CompWindow * w = findWindowAtScreen( s, ccontext->window );
+    if(w)
+      addWindowDamage( w );
+  } else if(ccontext->output >= 0 && ccontext->output < (int)ps->nContexts)
+  {
+    PrivDamageOutputs damage = { 1, &ps->draw[ccontext->output].xRect };
+    forEachWindowOnScreen( s, damageWindowOutputs, &damage );
+  }
+}
+
+/**
+ * Put a context with finished CLUT into the upload queue.
+ */
+static void queueUpload( CompScreen *s, PrivColorContext *ccontext )
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
+
+  if(ccontext->upload_pending)
+    return;
+
+  if(ps->nUploads >= ps->reservedUploads)
+  {
+    int reserved = ps->reservedUploads ? ps->reservedUploads * 2 : 16;
+    PrivColorContext ** uploads = cicc_alloc( reserved * sizeof(PrivColorContext*) );
+    if(!uploads)
+    {
+      /* upload now instead */
+      cdCreateTexture( ccontext );
+      return;
+    }
+    if(ps->uploads)
+    {
+      memcpy( uploads, ps->uploads, ps->nUploads * sizeof(PrivColorContext*) );
+      cicc_free( ps->uploads );
+    }
+    ps->uploads = uploads;
+    ps->reservedUploads = reserved;
+  }
+
+  ccontext->upload_pending = 1;
+  ps->uploads[ps->nUploads++] = ccontext;
+
+  /* request a frame */
+  damageColorContext( s, ccontext );
+}
+
+/**
+ * Remove a context from the upload queue, e.g. before it is freed.
+ */
+static void unqueueUpload( PrivScreen *ps, PrivColorContext *ccontext )
+{
+  if(!ccontext->upload_pending)
+    return;
+
+  for(int i = 0; i < ps->nUploads; ++i)
+    if(ps->uploads[i] == ccontext)
+    {
+      ps->uploads[i] = ps->uploads[--ps->nUploads];
+      break;
+    }
+  ccontext->upload_pending = 0;
+}
+
+/**
+ * Load the Oyranos modules and DB outside of compiz startup and begin
+ * with the output setup, which was held back until now.
+ */
+static void warmUpRun( PrivJob * job )
+{
+  struct timeval start, now;
+
+  gettimeofday( &start, NULL );
+  iccProfileFlags();
+  gettimeofday( &now, NULL );
+  job->usec = (long)(now.tv_sec - start.tv_sec) * 1000000 +
+              (now.tv_usec - start.tv_usec);
+}
+
+static void warmUpDone( PrivJob * job )
+{
+  CompScreen * s = job->s;
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
+
+  ps->warmUp = NULL;
+  oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                    DBG_STRING "Oyranos initialised in %ld ms", DBG_ARGS,
+                    job->usec / 1000 );
+
+  for(CompScreen * cs = s->display->screens; cs; cs = cs->next)
+  {
+    PrivScreen * cps = compObjectGetPrivate((CompObject *) cs);
+    if(colour_desktop_can && cps->setupStep == SETUP_IDLE &&
+       cs->nOutputDev != (int)cps->nContexts)
+      startOutputSetup( cs );
+  }
+}
+
+/**
+ * Load the Oyranos modules and DB in a worker, so the first frames are not
+ * held up. The outputs are set up, when it is done.
+ */
+static void warmUpOyranos( CompScreen * s )
+{
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
+  PrivJob * job = newJob( s, NULL, warmUpRun, warmUpDone );
+
+  if(!job)
+    return;
+
+  ps->warmUp = job;
+  submitJob( job );
+}
+
+/**
+ * Log once, when all outputs are corrected after activation.
+ */
+static void reportReady( CompScreen *s, const struct timeval * now )
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
+
+  if(ps->setupStep == SETUP_IDLE && !ps->nJobs && !ps->nUploads &&
+     ps->setupStart.tv_sec)
+  {
+    oyCompLogMessage( s->display, "compicc", CompLogLevelInfo,
+                      DBG_STRING "colour correction ready after %ld ms",
+                      DBG_ARGS,
+                      (long)(now->tv_sec - ps->setupStart.tv_sec) * 1000 +
+                      (now->tv_usec - ps->setupStart.tv_usec) / 1000 );
+    ps->setupStart.tv_sec = 0;
+  }
+}
+
+/**
+ * CompScreen::preparePaintScreen
+ *  Upload queued CLUTs within the per frame budget.
+ */
+static void pluginPreparePaintScreen( CompScreen *s, int msSinceLastPaint )
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
+  struct timeval start, now;
+  size_t bytes = 0;
+
+  UNWRAP(ps, s, preparePaintScreen);
+  (*s->preparePaintScreen) (s, msSinceLastPaint);
+  WRAP(ps, s, preparePaintScreen, pluginPreparePaintScreen);
+
+  if(!oyranosReady() && !ps->warmUp && colour_desktop_can)
+    warmUpOyranos( s );
+
+  /* free cache entries, which lost their last reference */
+  cacheEvict();
+
+  gettimeofday( &start, NULL );
+
+  /* also, when the setup ended without any CLUT */
+  reportReady( s, &start );
+
+  if(!ps->nUploads)
+    return;
+
+  while(ps->nUploads)
+  {
+    int best = 0, priority = PRIORITIES;
+    for(int i = 0; i < ps->nUploads && priority; ++i)
+    {
+      int p = colourPriority( s, ps->uploads[i] );
+      if(p < priority)
+      {
+        priority = p;
+        best = i;
+      }
+    }
+
+    PrivColorContext * c = ps->uploads[best];
+    ps->uploads[best] = ps->uploads[--ps->nUploads];
+    cdCreateTexture( c );
+    damageColorContext( s, c );
+    bytes += CLUT_SIZE;
+
+    gettimeofday( &now, NULL );
+    if(bytes + CLUT_SIZE > UPLOAD_BUDGET_BYTES ||
+       (now.tv_sec - start.tv_sec) * 1000000 +
+       (now.tv_usec - start.tv_usec) > UPLOAD_BUDGET_USEC)
+      break;
+  }
+
+  if(oy_debug && ps->nUploads)
+    fprintf( stderr, DBG_STRING"uploaded %lu bytes, %d CLUTs deferred\n",
+             DBG_ARGS, (unsigned long)bytes, ps->nUploads );
+
+  reportReady( s, &now );
+}
+
+/**
+ * CompScreen::donePaintScreen
+ *  Ask for one more frame, as long as CLUTs wait for their upload.
+ */
+static void pluginDonePaintScreen( CompScreen *s )
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
+
+  for(int i = 0; i < ps->nUploads; ++i)
+    damageColorContext( s, ps->uploads[i] );
+
+  UNWRAP(ps, s, donePaintScreen);
+  (*s->donePaintScreen) (s);
+  WRAP(ps, s, donePaintScreen, pluginDonePaintScreen);
+}
+
+/* returned profile is owned by user;
+ * release with oyProfile_Release(&returned_profile)
+ * For the server atom only the size is obtained and no profile returned.
+ */
+static oyProfile_s * getScreenProfile( CompScreen        * s,
+                                       int                 screen,
+                                       int                 server,
+                                       size_t            * size )
+{
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
+  Window root = RootWindow( s->display->display, 0 );
+  Atom a;
+  oyProfile_s * prof = NULL;
+
+  *size = 0;
+  if(screen < 0 || screen >= (int)ps->nContexts || !ps->profileAtoms)
+    return 0;
+
+  if(server)
+    a = ps->deviceProfileAtoms[screen];
+  else
+    a = ps->profileAtoms[screen];
+
+  oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                    DBG_STRING"fetching profile from %s %d atom: %d",
+                    DBG_ARGS,
+                    server ? XCM_DEVICE_PROFILE :
+                             XCM_ICC_V0_3_TARGET_PROFILE_IN_X_BASE, screen, a);
+
+  if(server)
+    *size = propertySize( s->display->display, root, a, XA_CARDINAL );
+  else
+    prof = profileFromProperty( s->display, root, a, size );
+  oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                    DBG_STRING"fetching %lu, found %lu: %s",
+                    DBG_ARGS,
+                    a,
+                    (unsigned long)*size, (*size == 0 ? "no data":"some data obtained") );
+  return prof;
+}
+
+static void changeProperty           ( Display           * display,
+                                       Atom                target_atom,
+                                       int                 type,
+                                       void              * data,
+                                       unsigned long       size )
+{
+  if(oy_debug)
+  {
+    char * atom_name = XGetAtomName( display, target_atom );
+    oyCompLogMessage( display, "compicc", CompLogLevelDebug,
+                    DBG_STRING"XChangeProperty atom: %s size: %lu",
+                    DBG_ARGS,
+                    atom_name, size );
+    XFree( atom_name );
+  }
+    XChangeProperty( display, RootWindow( display, 0 ),
+                     target_atom, type, 8, PropModeReplace,
+                     data, size );
+}
+
+/**
+ * Move the colour server profile atoms of several outputs directly on the
+ * compiz display connection and flush once for the whole batch.
+ * With init the _ICC_PROFILE(_n) content moves to _ICC_DEVICE_PROFILE(_n),
+ * unless that holds a profile already. Without init the device profile
+ * moves back to _ICC_PROFILE(_n).
+ * One XListProperties() tells, which atoms are set on the root window.
+ * The profiles are copied in chunks through the display property buffer.
+ */
+static void    moveICCprofileAtoms   ( CompScreen        * s,
+                                       const int         * screens,
+                                       int                 n,
+                                       int                 init )
+{
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
+  PrivDisplay * pd = compObjectGetPrivate((CompObject *) s->display);
+  PrivPropertyBuffer * buf = &pd->profileBuffer;
+  Display * dpy = s->display->display;
+  Window root = RootWindow( dpy, 0 );
+  Atom * set;
+  int nSet = 0;
+
+  if(!n || !ps->profileAtoms)
+    return;
+
+  set = XListProperties( dpy, root, &nSet );
+
+  for(int k = 0; k < n; ++k)
+  {
+    int i = screens[k], has_from = 0, has_to = 0;
+    Atom from, to;
+
+    if(i < 0 || i >= (int)ps->nContexts)
+      continue;
+
+    from = init ? ps->profileAtoms[i] : ps->deviceProfileAtoms[i];
+    to = init ? ps->deviceProfileAtoms[i] : ps->profileAtoms[i];
+    for(int j = 0; j < nSet; ++j)
+    {
+      if(set[j] == from) has_from = 1;
+      if(set[j] == to) has_to = 1;
+    }
+
+    oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                  DBG_STRING "Moving profiles on %s: for screen %d setup %d",
+                  DBG_ARGS, XDisplayString(dpy), i, init );
+
+    /* nothing to move or keep a device profile from a earlier start */
+    if(!has_from || (init && has_to))
+      continue;
+
+    if(fetchPropertyChunked( dpy, root, from, XA_CARDINAL, buf ) == 0)
+      XChangeProperty( dpy, root, to, XA_CARDINAL, 8, PropModeReplace,
+                       buf->data, buf->size );
+    XDeleteProperty( dpy, root, from );
+  }
+
+  if(set)
+    XFree( set );
+  trimPropertyBuffer( buf );
+
+  XFlush( dpy );
+}
+
+/**
+ * Read the geometry and name of an output from its Oyranos device.
+ */
+static int     getDeviceGeometry     ( CompScreen        * s,
+                                       PrivColorOutput   * output,
+                                       oyConfig_s        * device,
+                                       int                 screen )
+{
+  oyOption_s * o = 0;
+  oyRectangle_s * r = 0;
+  const char * device_name = 0;
+  char num[12];
+
+  snprintf( num, 12, "%d", (int)screen );
+
+    o = oyConfig_Find( device, "device_rectangle" );
+    if( !o )
+    {
+      oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
+                      DBG_STRING"monitor rectangle request failed", DBG_ARGS);
+      return 1;
+    }
+    r = (oyRectangle_s*) oyOption_GetStruct( o, oyOBJECT_RECTANGLE_S );
+    if( !r )
+    {
+      oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
+                      DBG_STRING"monitor rectangle request failed", DBG_ARGS);
+      return 1;
+    }
+    oyOption_Release( &o );
+
+    output->draw->xRect.x = oyRectangle_GetGeo1( r, 0 );
+    output->draw->xRect.y = oyRectangle_GetGeo1( r, 1 );
+    output->draw->xRect.width = oyRectangle_GetGeo1( r, 2 );
+    output->draw->xRect.height = oyRectangle_GetGeo1( r, 3 );
+
+    device_name = oyConfig_FindString( device, "device_name", 0 );
+    if(device_name && device_name[0])
+    {
+      strcpy( output->name, device_name );
+
+    } else
+    {
+       oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
+       DBG_STRING "oyDevicesGet list answere included no device_name",DBG_ARGS);
+
+       strcpy( output->name, num );
+    }
+
+  return 0;
+}
+
+static int     getDeviceProfile      ( CompScreen        * s,
+                                       PrivScreen        * ps,
+                                       oyConfig_s        * device,
+                                       int                 screen )
+{
+  PrivColorOutput * output = &ps->contexts[screen];
+  int error = 0;
+
+    if(getDeviceGeometry( s, output, device, screen ))
+      return 1;
+
+    oyProfile_Release( &output->cc.dst_profile );
+
+    size_t size = 0;
+    int server = 1;
+    /* try to get the device profile atom */
+    getScreenProfile( s, screen, server, &size );
+
+    /* check if the normal profile atom is a device profile */
+    if(!size)
+    {
+      server = 0;
+      output->cc.dst_profile = getScreenProfile( s, screen, server, &size );
+      if(!size)
+      oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                      DBG_STRING "no server profile on %s, size: %d",
+                      DBG_ARGS, output->name, (int)size);
+
+      /* filter out ordinary sRGB */
+      if(output->cc.dst_profile)
+      {
+        oyProfile_s * web = webProfile();
+        if(oyProfile_Equal( web, output->cc.dst_profile ))
+          oyProfile_Release( &output->cc.dst_profile );
+        oyProfile_Release( &web );
+      } else
+      oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                      DBG_STRING "no normal profile on %s, size: %d",
+                      DBG_ARGS, output->name, (int)size);
+    }
+
+  return error;
+}
+
+/**
+ * Ask Oyranos for the device profile, unless getDeviceProfile() found one
+ * in the X properties. This might generate a profile from EDID and runs
+ * without X or GL calls on a worker thread.
+ *
+ * @param[in]      id                  monitor identity for the profile cache
+ *                                     or NULL
+ * @param[in,out]  profile             the profile found in X or the result
+ */
+static int     askDeviceProfile      ( const char        * name,
+                                       const uint8_t     * id,
+                                       oyConfig_s        * device,
+                                       oyProfile_s      ** profile )
+{
+  int error = 0, t_err = 0, searched = 0;
+
+    if(*profile)
+    {
+      oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "reusing existing profile on %s",
+                      DBG_ARGS, name );
+    } else if(id &&
+              (*profile = lookupResolvedProfile( id )) != NULL)
+    {
+      oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "known monitor on %s: %s",
+                      DBG_ARGS, name,
+                      oyProfile_GetFileName( *profile, -1 ) );
+    } else
+    {
+      searched = 1;
+      oyOptions_s * options = 0;
+      oyOptions_SetFromString( &options,
+                   "//" OY_TYPE_STD "/config/command",
+                                       "list", OY_CREATE_NEW );
+      oyOptions_SetFromInt( &options,
+                            "////icc_profile_flags",
+                            iccProfileFlags(), 0, OY_CREATE_NEW );
+      oyOptions_SetFromString( &options,
+                   "//" OY_TYPE_STD "/config/icc_profile.x_color_region_target",
+                                       "yes", OY_CREATE_NEW );
+      pthread_mutex_lock( &oy_mutex );
+      t_err = oyDeviceAskProfile2( device, options, &*profile );
+      if(t_err)
+        oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "oyDeviceAskProfile2() returned an issue %s: %d",
+                      DBG_ARGS, name, t_err);
+      if(!*profile || t_err == -1)
+      {
+        int old_t_err = t_err;
+        t_err = oyDeviceGetProfile( device, options, &*profile );
+        oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "oyDeviceAskProfile2() has \"%s\" profile on %s: %d oyDeviceGetProfile() got -> \"%s\" %d",
+                      DBG_ARGS, *profile ? oyProfile_GetText(*profile, oyNAME_DESCRIPTION):"----",
+                      name, old_t_err, oyProfile_GetText(*profile, oyNAME_DESCRIPTION), t_err);
+      }
+      pthread_mutex_unlock( &oy_mutex );
+      oyOptions_Release( &options );
+    }
+
+    if(*profile)
+    {
+      /* check that no sRGB is delivered */
+      if(t_err)
+      {
+        oyProfile_s * web = webProfile();
+        if(oyProfile_Equal( web, *profile ))
+        {
+          oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "Output %s ignoring sRGB fallback %d %d",
+                      DBG_ARGS, name, error, t_err);
+          oyProfile_Release( &*profile );
+          error = 1;
+        }
+        oyProfile_Release( &web );
+      }
+    } else
+    {
+      oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
+                      DBG_STRING "Output %s: no ICC profile found %d",
+                      DBG_ARGS, name, error);
+      error = 1;
+    }
+
+    if(searched && *profile && id)
+      storeResolvedProfile( id, *profile );
+
+  return error;
+}
+
+/**
+ * Convert the identity grid in CLUT_SLICES slices of blue planes, each
+ * with its own conversion. Oyranos caches the transform, so only the first
+ * slice pays for it. A cancelled job stops between slices.
+ *
+ * @param[in]      cmm                 CMM context or NULL for the default
+ *
+ * @return                             - 0  success
+ *                                     - -1 cancelled
+ *                                     - >0 error
+ */
+#define CLUT_SLICES 8
+static int     runColourTable        ( GLushort         (* clut)[GRIDPOINTS][GRIDPOINTS][3],
+                                       oyProfile_s       * src_profile,
+                                       oyProfile_s       * dst_profile,
+                                       const char        * cmm,
+                                       int                 flags,
+                                       const int         * cancel )
+{
+  int planes = GRIDPOINTS / CLUT_SLICES,
+      error = 0;
+
+  for(int k = 0; k < CLUT_SLICES && !error; ++k)
+  {
+    oyOptions_s * options = 0;
+    oyConversion_s * cc;
+    oyImage_s * image_in, * image_out;
+
+    if(jobCancelled( cancel ))
+      return -1;
+
+    image_in  = oyImage_Create( GRIDPOINTS, GRIDPOINTS*planes, clut[k*planes],
+                                OY_TYPE_123_16, src_profile, 0 );
+    image_out = oyImage_Create( GRIDPOINTS, GRIDPOINTS*planes, clut[k*planes],
+                                OY_TYPE_123_16, dst_profile, 0 );
+    if(cmm)
+      oyOptions_SetFromString( &options, OY_DEFAULT_CMM_CONTEXT, cmm,
+                               OY_CREATE_NEW );
+    pthread_mutex_lock( &oy_mutex );
+    cc = oyConversion_CreateBasicPixels( image_in, image_out, options, 0 );
+    oyOptions_Release( &options );
+
+    if(cc)
+    {
+      oyOptions_SetFromString( &options,
+                               "//" OY_TYPE_STD "/config/display_mode", "1",
+                               OY_CREATE_NEW );
+      error = oyConversion_Correct( cc, "//" OY_TYPE_STD "/icc_color", flags,
+                                    options );
+      pthread_mutex_unlock( &oy_mutex );
+      if(!error)
+        error = oyConversion_RunPixels( cc, 0 );
+      oyOptions_Release( &options );
+    } else
+    {
+      pthread_mutex_unlock( &oy_mutex );
+      error = 1;
+    }
+
+    oyConversion_Release( &cc );
+    oyImage_Release( &image_in );
+    oyImage_Release( &image_out );
+  }
+
+  return error;
+}
+
+/**
+ * Build the conversion for one pixel. The pixel is never run; the graph
+ * names the transform for the cache and gives the device link.
+ *
+ * @return                             the icc_color node or NULL
+ */
+static oyFilterNode_s * probeColourTable( oyImage_s         * image_in,
+                                       oyImage_s         * image_out,
+                                       const char        * cmm,
+                                       int                 flags )
+{
+  oyConversion_s * cc;
+  oyOptions_s * options = 0;
+  oyFilterNode_s * icc = NULL;
+
+  if(cmm)
+    oyOptions_SetFromString( &options, OY_DEFAULT_CMM_CONTEXT, cmm,
+                             OY_CREATE_NEW );
+  pthread_mutex_lock( &oy_mutex );
+  cc = oyConversion_CreateBasicPixels( image_in, image_out, options, 0 );
+  oyOptions_Release( &options );
+
+  if(cc)
+  {
+    oyOptions_SetFromString( &options,
+                             "//" OY_TYPE_STD "/config/display_mode", "1",
+                             OY_CREATE_NEW );
+    if(!oyConversion_Correct( cc, "//" OY_TYPE_STD "/icc_color", flags,
+                              options ))
+    {
+      oyFilterGraph_s * cc_graph = oyConversion_GetGraph( cc );
+      icc = oyFilterGraph_GetNode( cc_graph, -1, "///icc_color", 0 );
+      oyFilterGraph_Release( &cc_graph );
+    }
+    oyOptions_Release( &options );
+  }
+  pthread_mutex_unlock( &oy_mutex );
+
+  oyConversion_Release( &cc );
+  return icc;
+}
+
+/**
+ * Build the CLUT of a colour context. Only Oyranos and the contexts own
+ * memory are touched, so it runs in a worker job on a copy of the context.
+ * The job completion uploads the CLUT with queueUpload().
+ * A new CLUT moves into the cache. On success ccontext->cache holds a
+ * reference, see cacheRelease(), or ccontext->clut holds the table, when no
+ * cache entry could be made.
+ *
+ * @param[in]      cancel              checked between the steps or NULL
+ *
+ * @return                             - 0  CLUT is ready
+ *                                     - 1  no CLUT or cancelled
+ */
+static int     setupColourTable      ( PrivColorContext  * ccontext,
+                                       int                 advanced,
+                                       const int         * cancel )
+{
+  int error = 0,
+      status = 1;
+  oyProfile_s * dst_profile = ccontext->dst_profile, * web = 0,
+              * src_profile = 0;
+  oyImage_s * image_in = 0, * image_out = 0;
+  oyFilterNode_s * icc = 0;
+  oyBlob_s * blob = 0;
+  char * hash_text = 0;
+  uint16_t pixel[3] = {0,0,0};
+
+  memset( ccontext->transform_md5, 0, 16 );
+  cacheRelease( &ccontext->cache );
+
+    if(jobCancelled( cancel ))
+      return status;
+
+    if(!ccontext->dst_profile)
+      dst_profile = web = webProfile();
+
+    {
+      int flags = 0;
+      const char * cmm = NULL;
+
+      src_profile = oyProfile_Copy( ccontext->src_profile, 0 );
+
+      oyPixel_t pixel_layout = OY_TYPE_123_16;
+      oyCompLogMessage(NULL, "compicc", CompLogLevelDebug,
+             DBG_STRING "%s -> %s",
+             DBG_ARGS, oyProfile_GetText( src_profile, oyNAME_DESCRIPTION ),
+                       oyProfile_GetText( dst_profile, oyNAME_DESCRIPTION ) );
+
+      /* skip web to web conversion */
+      if(oyProfile_Equal( src_profile, web ))
+      {
+        oyCompLogMessage(NULL, "compicc", CompLogLevelDebug,
+             DBG_STRING "src_profile == web",
+             DBG_ARGS );
+        goto clean_setupColourTable;
+      }
+
+      if(!src_profile)
+        src_profile = webProfile();
+
+      if(!src_profile)
+        oyCompLogMessage(NULL, "compicc", CompLogLevelWarn,
+             DBG_STRING "Output %s: no oyASSUMED_WEB src_profile",
+             DBG_ARGS, ccontext->output_name );
+
+      /* optionally set advanced options from Oyranos */
+      if(advanced)
+        flags = oyOPTIONATTRIBUTE_ADVANCED;
+
+      oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "oyConversion_Correct(///icc_color,%d,0) %s %s",
+                      DBG_ARGS, flags, ccontext->output_name,
+                      advanced?"advanced":"");
+      /* the table itself is filled by runColourTable() */
+      image_in = oyImage_Create( 1, 1, pixel, pixel_layout, src_profile, 0 );
+      image_out= oyImage_Create( 1, 1, pixel, pixel_layout, dst_profile, 0 );
+
+      icc = probeColourTable( image_in, image_out, cmm, flags );
+      if(!icc)
+      {
+        oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
+                      DBG_STRING "no conversion created for %s",
+                      DBG_ARGS, ccontext->output_name);
+        goto clean_setupColourTable;
+      }
+
+      if(jobCancelled( cancel ))
+        goto clean_setupColourTable;
+
+      pthread_mutex_lock( &oy_mutex );
+      {
+        const char * t = oyFilterNode_GetText( icc, oyNAME_NAME );
+        if(t)
+        {
+          hash_text = strdup(t);
+          oyMiscBlobGetMD5_( (void*) t, strlen(t), ccontext->transform_md5 );
+        }
+      }
+      pthread_mutex_unlock( &oy_mutex );
+      PrivCacheEntry * entry = cacheAcquire( hash_text );
+      GLushort (*clut)[GRIDPOINTS][GRIDPOINTS][3] = entry ? entry->clut : NULL;
+      if(!clut)
+        cacheRelease( &entry );
+
+      oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "clut from cache %s %s",
+                      DBG_ARGS, clut?"obtained":"no", hash_text );
+      if(clut)
+      {
+        ccontext->cache = entry;
+      } else
+      {
+        pthread_mutex_lock( &oy_mutex );
+        blob = oyFilterNode_ToBlob( icc, NULL );
+        pthread_mutex_unlock( &oy_mutex );
+
+        if(!blob)
+        {
+          oyFilterNode_Release( &icc );
+
+          cmm = "lcm2";
+          icc = probeColourTable( image_in, image_out, cmm, flags );
+          if(!icc)
+          {
+            oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
+                      DBG_STRING "no conversion created for %s",
+                      DBG_ARGS, ccontext->output_name);
+            goto clean_setupColourTable;
+          }
+          pthread_mutex_lock( &oy_mutex );
+          blob = oyFilterNode_ToBlob( icc, NULL );
+          pthread_mutex_unlock( &oy_mutex );
+          oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "created %s",
+                      DBG_ARGS, hash_text );
+        }
+
+        if(oy_debug)
+        {
+          oyOptions_s * node_opts = oyFilterNode_GetOptions( icc, 0 );
           oyProfile_s * dl;
-          dl = oyProfile_FromMem( oyBlob_GetSize( blob ),
-                                oyBlob_GetPointer( blob ), 0,0 );
+          dl = profileFromMem( oyBlob_GetSize( blob ),
+                               oyBlob_GetPointer( blob ) );
           const char * fn;
           int j = 0;
           while((fn = oyProfile_GetFileName( dl, j )) != NULL)
             fprintf( stdout, " -> \"%s\"[%d]", fn?fn:"----", j++ );
           fprintf( stdout, "\n" );
           fprintf( stdout, "%s\n", oyOptions_GetText( node_opts, oyNAME_NAME ) );
+          oyProfile_Release( &dl );
+          oyOptions_Release( &node_opts );
+        }
+
+        /* only a cache miss needs the table */
+        if(!ccontext->clut)
+          ccontext->clut = cicc_alloc( CLUT_SIZE );
+        if(!ccontext->clut)
+          goto clean_setupColourTable;
+
+        uint16_t in[3];
+        for (int r = 0; r < GRIDPOINTS; ++r)
+        {
+          in[0] = floor((double) r / (GRIDPOINTS - 1) * 65535.0 + 0.5);
+          for (int g = 0; g < GRIDPOINTS; ++g) {
+            in[1] = floor((double) g / (GRIDPOINTS - 1) * 65535.0 + 0.5);
+            for (int b = 0; b < GRIDPOINTS; ++b)
+            {
+              in[2] = floor((double) b / (GRIDPOINTS - 1) * 65535.0 + 0.5);
+              for(int j = 0; j < 3; ++j)
+                /* BGR */
+                ccontext->clut[b][g][r][j] = in[j];
+            }
+          }
+        }
+
+        error = runColourTable( ccontext->clut, src_profile, dst_profile, cmm,
+                                flags, cancel );
+
+        if(error < 0)
+          goto clean_setupColourTable;
+        if(error)
+        {
+          oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
+                      DBG_STRING "oyConversion_RunPixels() error: %d %s",
+                      DBG_ARGS, error, ccontext->output_name);
+          goto clean_setupColourTable;
+        }
+
+        if(oy_debug >= 2)
+        {
+          char * fn = 0;
+          static int c = 0;
+          oyImage_s * table = oyImage_Create( GRIDPOINTS,GRIDPOINTS*GRIDPOINTS,
+                                             ccontext->clut,
+                                             pixel_layout, dst_profile, 0 );
+          oyStringAddPrintf( &fn, malloc, free, "dbg-clut-%d.ppm", c);
+          oyImage_WritePPM(table, fn, hash_text);
+          oyImage_Release( &table );
+          free(fn); fn = 0;
+          oyStringAddPrintf( &fn, malloc, free, "dbg-clut-%d.icc", c++);
+          FILE*fp=fopen(fn,"w");
+          if(fp) fwrite( oyBlob_GetPointer( blob ), sizeof(char), oyBlob_GetSize( blob ), fp );
+          if(fp) fclose(fp);
+          free(fn);
         }
+      }
+
+      /* hand the new CLUT over to the cache; a concurrent build of the
+       * same transform might have been faster */
+      if(!ccontext->cache && hash_text)
+      {
+        ccontext->cache = cacheInsert( hash_text, NULL, ccontext->clut );
+        if(ccontext->cache)
+          ccontext->clut = NULL;
+      }
+
+      status = 0;
+    }
+
+    if(!ccontext->dst_profile)
+    {
+      oyCompLogMessage( NULL, "compicc", CompLogLevelInfo,
+                      DBG_STRING "Output \"%s\": no profile",
+                      DBG_ARGS, ccontext->output_name);
+    }
+
+    clean_setupColourTable:
+    if(hash_text)
+      free( hash_text );
+    oyBlob_Release( &blob );
+    oyFilterNode_Release( &icc );
+    oyImage_Release( &image_in );
+    oyImage_Release( &image_out );
+    /* the scratch table is not needed with a cached one */
+    if(ccontext->cache && ccontext->clut)
+    {
+      cicc_free( ccontext->clut );
+      ccontext->clut = NULL;
+    }
+    if(web)
+      oyProfile_Release( &web );
+    oyProfile_Release( &src_profile );
+
+  return status;
+}
+
+static int     getDisplayAdvanced    ( CompScreen        * s,
+                                       int                 screen OY_UNUSED )
+{
+  CompDisplay * d = s->display;
+  PrivDisplay * pd = compObjectGetPrivate((CompObject *) d);
+  unsigned long nBytes;
+  char * opt = 0;
+  int advanced = 0;
+  Window root = RootWindow( s->display->display, 0 );
+
+  /* optionally set advanced options from Oyranos */
+  opt = fetchProperty( s->display->display, root, pd->iccDisplayAdvanced,
+                       XA_STRING, &nBytes, False );
+  if(oy_debug)
+        printf( DBG_STRING "iccDisplayAdvanced: %s %lu\n",
+                DBG_ARGS, opt?opt:"", nBytes);
+  if(opt && nBytes && atoi(opt) > 0)
+        advanced = atoi(opt);
+  if(opt)
+  {     XFree( opt ); opt = 0; }
+
+  return advanced;
+}
+
+/**
+ * Prepare the colour context of an output for setupColourTable().
+ */
+static void    setupOutputTable      ( CompScreen        * s,
+                                       int                 screen )
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
+  PrivColorOutput * output = &ps->contexts[screen];
 
-        uint16_t in[3];
-        for (int r = 0; r < GRIDPOINTS; ++r)
-        {
-          in[0] = floor((double) r / (GRIDPOINTS - 1) * 65535.0 + 0.5);
-          for (int g = 0; g < GRIDPOINTS; ++g) {
-            in[1] = floor((double) g / (GRIDPOINTS - 1) * 65535.0 + 0.5);
-            for (int b = 0; b < GRIDPOINTS; ++b)
-            {
-              in[2] = floor((double) b / (GRIDPOINTS - 1) * 65535.0 + 0.5);
-              for(int j = 0; j < 3; ++j)
-                /* BGR */
-                ccontext->clut[b][g][r][j] = in[j];
-            }
-          }
-        }
 
-        clut = oyArray2d_Create( NULL, GRIDPOINTS*3, GRIDPOINTS*GRIDPOINTS,
-                                 oyUINT16, NULL );
+  if(!colour_desktop_can)
+    return;
+
+
+  /* contexts stay across reconfigurations; jobs hold their own copies */
+  oyProfile_Release( &output->cc.src_profile );
+  if(output->cc.output_name)
+    free( output->cc.output_name );
+
+  output->cc.src_profile = webProfile();
+  output->cc.output_name = strdup(output->name);
+  output->cc.output = screen;
+  output->cc.window = None;
+  if(!output->cc.src_profile)
+    oyCompLogMessage(s->display, "compicc", CompLogLevelWarn,
+             DBG_STRING "Output %s: no oyASSUMED_WEB src_profile",
+             DBG_ARGS, output->name );
+}
+
+static void freeOutputContexts( PrivScreen *ps, PrivColorOutput *contexts,
+                                PrivOutputDraw *draw, unsigned long n )
+{
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    cancelJob( contexts[i].cc.job );
+    unqueueUpload( ps, &contexts[i].cc );
+    if(contexts[i].cc.dst_profile)
+      oyProfile_Release( &contexts[i].cc.dst_profile );
+    if(contexts[i].cc.src_profile)
+      oyProfile_Release( &contexts[i].cc.src_profile );
+    if(contexts[i].cc.output_name)
+      free( contexts[i].cc.output_name );
+    contexts[i].cc.output_name = NULL;
+    if(contexts[i].cc.clut)
+      cicc_free( contexts[i].cc.clut );
+    contexts[i].cc.clut = NULL;
+    cacheRelease( &contexts[i].cc.cache );
+    if(draw[i].texture.glTexture)
+      glDeleteTextures( 1, &draw[i].texture.glTexture );
+    draw[i].texture.glTexture = 0;
+  }
+  if(contexts)
+    cicc_free( contexts );
+  if(draw)
+    cicc_free( draw );
+}
+
+static void freeOutput( PrivScreen *ps )
+{
+  freeOutputContexts( ps, ps->contexts, ps->draw, ps->nContexts );
+  ps->contexts = NULL;
+  ps->draw = NULL;
+  ps->nContexts = 0;
+
+  if(ps->profileAtoms)
+    cicc_free(ps->profileAtoms);
+  ps->profileAtoms = ps->deviceProfileAtoms = NULL;
+}
+
+
+void cleanDisplayProfiles( CompScreen *s )
+{
+    oyOptions_s * opts = 0,
+                * result = 0;
+
+    oyOptions_SetFromString( &opts, "////display_name",
+                           XDisplayString(s->display->display), OY_CREATE_NEW );
+    pthread_mutex_lock( &oy_mutex );
+    oyOptions_Handle( "//" OY_TYPE_STD "/clean_profiles",
+                                opts,"clean_profiles",
+                                &result );
+    pthread_mutex_unlock( &oy_mutex );
+    oyOptions_Release( &opts );
+    oyOptions_Release( &result );
+    return;
+}
+
+/**
+ * Intern the _ICC_PROFILE(_xxx) and _ICC_DEVICE_PROFILE(_xxx) atoms for all
+ * outputs with one round trip.
+ */
+static void setupOutputAtoms( CompScreen *s, PrivScreen *ps )
+{
+  int n = ps->nContexts;
+  char ** names;
+  char (*text)[64];
+
+  if(n <= 0)
+    return;
+
+  /* the names are bounded, so they share one block with their pointers */
+  ps->profileAtoms = (Atom*) cicc_alloc( 2 * n * sizeof(Atom) );
+  names = (char**) cicc_alloc( 2 * n * (sizeof(char*) + 64) );
+  if(!ps->profileAtoms || !names)
+  {
+    if(ps->profileAtoms) cicc_free( ps->profileAtoms );
+    if(names) cicc_free( names );
+    ps->profileAtoms = ps->deviceProfileAtoms = NULL;
+    return;
+  }
+  ps->deviceProfileAtoms = ps->profileAtoms + n;
+  text = (char(*)[64]) (names + 2 * n);
+
+  for(int i = 0; i < n; ++i)
+  {
+    char num[12];
+    snprintf( num, 12, "%d", i );
+    names[i] = text[i];
+    names[n + i] = text[n + i];
+    snprintf( names[i], 64, XCM_ICC_V0_3_TARGET_PROFILE_IN_X_BASE"%s%s",
+              i ? "_" : "", i ? num : "" );
+    snprintf( names[n + i], 64, XCM_DEVICE_PROFILE"%s%s",
+              i ? "_" : "", i ? num : "" );
+  }
+
+  XInternAtoms( s->display->display, names, 2 * n, False, ps->profileAtoms );
+
+  cicc_free( names );
+}
+
+/**
+ * Called when output configuration (or properties) change.
+ */
+static void setupOutputs(CompScreen *s)
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
+  int n;
+  CompDisplay * d = s->display;
+
+  /* adoptOutputs() copies the contexts; results for the old ones are stale */
+  for(unsigned long i = 0; i < ps->nContexts; ++i)
+    cancelJob( ps->contexts[i].cc.job );
+
+  /* keep the configured outputs for adoptOutputs(), which runs right after */
+  if(!ps->oldContexts)
+  {
+    ps->oldContexts = ps->contexts;
+    ps->oldDraw = ps->draw;
+    ps->nOldContexts = ps->nContexts;
+    ps->contexts = NULL;
+    ps->draw = NULL;
+    ps->nContexts = 0;
+  }
+  freeOutput(ps);
+
+  n = s->nOutputDev;
+
+  oyCompLogMessage(d, "compicc", CompLogLevelDebug, DBG_STRING "nOutputDev: %d", DBG_ARGS, n );
+  {
+    int i;
+    ps->nContexts = n;
+    ps->contexts = (PrivColorOutput*)cicc_alloc( ps->nContexts *
+                                             sizeof(PrivColorOutput ));
+    ps->draw = (PrivOutputDraw*)cicc_alloc( ps->nContexts *
+                                            sizeof(PrivOutputDraw ));
+    for(i = 0; i < n; ++i)
+    {
+      ps->contexts[i].cc.ref = 1;
+      ps->contexts[i].draw = &ps->draw[i];
+      ps->contexts[i].cc.texture = &ps->draw[i].texture;
+    }
+  }
+
+  setupOutputAtoms( s, ps );
+
+  /* allow Oyranos to see modifications made to the compiz Xlib context */
+  XFlush( s->display->display );
+}
+
+/* the monitors of the last enumeration */
+oyConfigs_s * old_devices = NULL;
+/* old_devices was enumerated for the pending reconciliation; cleared on use */
+static int old_devices_fresh = 0;
+
+/**
+ * Enumerate the monitors with geometry and refreshed EDID.
+ * This is the only oyDevicesGet() call for monitors; the result is kept in
+ * old_devices and shared by needUpdate(), getOutputDevices() and
+ * updateOutputGeometry().
+ */
+static oyConfigs_s * enumerateDevices( Display           * display )
+{
+  int error = 0;
+  oyOptions_s * options = 0;
+  oyConfigs_s * devices = 0;
+
+  /* allow Oyranos to see modifications made to the compiz Xlib context */
+  XFlush( display );
+
+  /* obtain device informations, including geometry and ICC profiles
+     from the according Oyranos module */
+  error = oyOptions_SetFromString( &options, "//" OY_TYPE_STD "/config/command",
+                                 "list", OY_CREATE_NEW );
+  if(error) fprintf(stdout,"%s %d", "found issues",error);
+  error = oyOptions_SetFromString( &options, "//" OY_TYPE_STD "/config/device_rectangle",
+                                 "true", OY_CREATE_NEW );
+  if(error) fprintf(stdout,"%s %d", "found issues",error);
+  error = oyOptions_SetFromString( &options, "//" OY_TYPE_STD "/config/edid",
+                                 "refresh", OY_CREATE_NEW );
+  pthread_mutex_lock( &oy_mutex );
+  error = oyDevicesGet( OY_TYPE_STD, "monitor", options, &devices );
+  pthread_mutex_unlock( &oy_mutex );
+  if(error > 0)
+          oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
+                      DBG_STRING "oyDevicesGet() error: %d",
+                      DBG_ARGS, error);
+  oyOptions_Release( &options );
+
+  return devices;
+}
+
+/**
+ * Compare the monitors with the ones seen at the last call.
+ *
+ * @return                             - UPDATE_NONE      unchanged
+ *                                     - UPDATE_GEOMETRY  only moved or resized
+ *                                     - UPDATE_DEVICES   monitors changed
+ */
+int            needUpdate            ( Display           * display )
+{
+  int i, n, update = 0;
+  oyConfigs_s * devices = enumerateDevices( display );
+  oyConfig_s * device = 0, * old_device = 0;
+
+  n = oyConfigs_Count( devices );
+  /* find out if monitors have changed at all;
+   * EDID's and enumeration are device changes, dimension only geometry */
+  if(n != oyConfigs_Count( old_devices ))
+    update = UPDATE_DEVICES;
+  else
+  for(i = 0; i < n; ++i)
+  {
+    const char * edid, * old_edid, * rect, * old_rect;
+    device = oyConfigs_Get( devices, i );
+    old_device = oyConfigs_Get( old_devices, i );
+    edid = oyOptions_FindString( *oyConfig_GetOptions(device,"backend_core"),"EDID",0 );
+    old_edid = oyOptions_FindString( *oyConfig_GetOptions(old_device,"backend_core"),"EDID",0 );
+    rect = oyOptions_FindString( *oyConfig_GetOptions(device,"backend_core"),"display_geometry",0 );
+    old_rect = oyOptions_FindString( *oyConfig_GetOptions(old_device,"backend_core"),"display_geometry",0 );
+
+    if(!edid || !old_edid || strcmp(edid,old_edid) != 0)
+      update = UPDATE_DEVICES;
+    else if(!rect || !old_rect || strcmp(rect,old_rect) != 0)
+      update = UPDATE_GEOMETRY;
+
+    oyConfig_Release( &device );
+    oyConfig_Release( &old_device );
+    if(update == UPDATE_DEVICES) break;
+  }
+
+  oyConfigs_Release( &old_devices );
+  old_devices = devices;
+  /* only a change is followed by a reconciliation, which uses it */
+  old_devices_fresh = update != UPDATE_NONE;
+
+  oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                    DBG_STRING "update: %d", DBG_ARGS, update );
+  return update;
+}
+
+/**
+ * The monitors stayed the same and only moved or changed their resolution.
+ * Update the output rectangles from the devices of the last needUpdate()
+ * call and keep all profiles, CLUTs and textures.
+ */
+static void updateOutputGeometry( CompScreen * s )
+{
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
+
+  /* a pending setup reads the geometry anyway */
+  if(ps->setupStep != SETUP_IDLE ||
+     oyConfigs_Count( old_devices ) != (int)ps->nContexts)
+  {
+    startOutputSetup( s );
+    return;
+  }
+
+  for (unsigned long i = 0; i < ps->nContexts; ++i)
+  {
+    oyConfig_s * device = oyConfigs_Get( old_devices, i );
+    getDeviceGeometry( s, &ps->contexts[i], device, i );
+    oyConfig_Release( &device );
+  }
+
+  damageScreen( s );
+}
+
+/**
+ * Oyranos DB files, which are watched by refreshOyranosDB().
+ * The settings directories come from oyGetInstallPath(oyPATH_POLICY) for
+ * the user and the system scope, followed by the further XDG_CONFIG_DIRS
+ * entries, which the JSON backend reads as well. The file name is the one
+ * of that default backend; other DB backends are not watched and their
+ * changes are only seen after a full reset, e.g. by a monitor hotplug.
+ */
+#define OY_DB_FILES 8
+#define OY_DB_NAME "/openicc.json"
+#define OY_DB_XDG_DIR "/color/settings"
+static struct {
+  char * path;
+  time_t mtime;
+  off_t size;
+  int exists;
+} oy_db_files[OY_DB_FILES];
+static int oy_db_files_n = 0;
+
+/* identifies the Oyranos configuration for the resolved profiles cache:
+ * the DB part from refreshOyranosDB() and the profile directories stamp,
+ * which the output jobs renew in updatePolicyFingerprint() */
+static uint8_t oy_policy_fingerprint[16];
+static uint8_t oy_db_fingerprint[16];
+static int oy_db_fingerprint_set = 0;
+static int oy_profile_dirs_stale = 1;
+/* guards the fingerprints and the resolved profiles below */
+static pthread_mutex_t resolved_profiles_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* depth of subdirectories below the profile paths, e.g. devices/display */
+#define PROFILE_DIRS_DEPTH 3
+
+/* add the modification times of dir and its subdirectories to stamp */
+static void    profileDirStamp       ( const char        * dir,
+                                       int                 depth,
+                                       long long         * stamp )
+{
+  struct stat st;
+  struct dirent * entry;
+  DIR * d;
+
+  if(stat( dir, &st ) != 0 || !S_ISDIR( st.st_mode ))
+    return;
+  /* order independent, readdir() has no fixed order */
+  *stamp += (long long)st.st_mtime ^ ((long long)st.st_ino << 20);
+
+  if(depth <= 0 || !(d = opendir( dir )))
+    return;
+  while((entry = readdir( d )) != NULL)
+  {
+    char * path = NULL;
+    if(entry->d_name[0] == '.')
+      continue;
+    oyStringAddPrintf( &path, malloc, free, "%s/%s", dir, entry->d_name );
+    if(path)
+    {
+      profileDirStamp( path, depth - 1, stamp );
+      free( path );
+    }
+  }
+  closedir( d );
+}
+
+/**
+ * Stamp of the Oyranos profile paths. Installed or removed profiles change
+ * it; a profile file rewritten in place is caught by the MD5 check in
+ * lookupResolvedProfile().
+ */
+static long long profileDirsStamp    ( void )
+{
+  long long stamp = 0;
+  int n = 0;
+  char ** paths;
+
+  pthread_mutex_lock( &oy_mutex );
+  paths = oyProfilePathsGet( &n, malloc );
+  pthread_mutex_unlock( &oy_mutex );
+
+  for(int i = 0; i < n; ++i)
+  {
+    if(paths[i])
+    {
+      profileDirStamp( paths[i], PROFILE_DIRS_DEPTH, &stamp );
+      free( paths[i] );
+    }
+  }
+  if(paths)
+    free( paths );
+
+  return stamp;
+}
+
+/* DB keys read by compicc: monitor device settings and the CMM policy */
+static const char * oy_db_keys[] = { OY_STD "/device", OY_BEHAVIOUR_STD, NULL };
+
+/**
+ * Reload the Oyranos DB keys needed for the monitors, if a DB file changed.
+ * Appearing or removed DB files need a full reset of the DB cache. Without
+ * change nothing is reloaded. The DB files and the policy flags go into the
+ * fingerprint for the resolved profiles; the profile paths are stamped
+ * later by the output jobs.
+ * Nothing is read before the warm up job has initialised Oyranos.
+ *
+ * @return                             - 0  unchanged
+ *                                     - 1  keys reloaded
+ *                                     - 2  full reset
+ */
+static int     refreshOyranosDB      ( void )
+{
+  int changed = 0, full = 0, first;
+
+  /* the DB is read fresh, when the warm up job initialises Oyranos */
+  if(!oyranosReady())
+    return 0;
+
+  first = !oy_db_files_n;
+  if(first)
+  {
+    oySCOPE_e scopes[] = { oySCOPE_USER, oySCOPE_SYSTEM };
+    const char * dirs = getenv("XDG_CONFIG_DIRS");
+
+    pthread_mutex_lock( &oy_mutex );
+    for(int i = 0; i < 2; ++i)
+    {
+      char * dir = oyGetInstallPath( oyPATH_POLICY, scopes[i], malloc );
+      if(dir)
+      {
+        oyStringAddPrintf( &oy_db_files[oy_db_files_n++].path, malloc, free,
+                           "%s" OY_DB_NAME, dir );
+        free( dir );
+      }
+    }
+    pthread_mutex_unlock( &oy_mutex );
+
+    if(!dirs || !dirs[0])
+      dirs = "/etc/xdg";
+    while(*dirs && oy_db_files_n < OY_DB_FILES)
+    {
+      int len = strcspn( dirs, ":" ), known = 0;
+      char * path = NULL;
+      if(len)
+        oyStringAddPrintf( &path, malloc, free,
+                           "%.*s" OY_DB_XDG_DIR OY_DB_NAME, len, dirs );
+      for(int i = 0; path && i < oy_db_files_n; ++i)
+        if(oy_db_files[i].path && strcmp( oy_db_files[i].path, path ) == 0)
+          known = 1;
+      if(path && !known)
+        oy_db_files[oy_db_files_n++].path = path;
+      else if(path)
+        free( path );
+      dirs += len;
+      if(*dirs == ':')
+        ++dirs;
+    }
+  }
+
+  for(int i = 0; i < oy_db_files_n; ++i)
+  {
+    struct stat st;
+    int exists = oy_db_files[i].path && stat( oy_db_files[i].path, &st ) == 0;
+
+    if(exists != oy_db_files[i].exists)
+      full = 1;
+    else if(exists && (st.st_mtime != oy_db_files[i].mtime ||
+                       st.st_size != oy_db_files[i].size))
+      changed = 1;
+
+    oy_db_files[i].exists = exists;
+    oy_db_files[i].mtime = exists ? st.st_mtime : 0;
+    oy_db_files[i].size = exists ? st.st_size : 0;
+  }
+
+  int flags = iccProfileFlags();
+  pthread_mutex_lock( &resolved_profiles_mutex );
+  if(full || changed || !oy_db_fingerprint_set)
+  {
+    long long v[OY_DB_FILES * 3 + 1];
+    for(int i = 0; i < OY_DB_FILES; ++i)
+    {
+      v[i*3 + 0] = oy_db_files[i].exists;
+      v[i*3 + 1] = oy_db_files[i].mtime;
+      v[i*3 + 2] = oy_db_files[i].size;
+    }
+    v[OY_DB_FILES * 3] = flags;
+    oyMiscBlobGetMD5_( v, sizeof(v), oy_db_fingerprint );
+    oy_db_fingerprint_set = 1;
+  }
+  /* profiles might be installed at any time; the walk through the profile
+   * directories is left to the next output job */
+  oy_profile_dirs_stale = 1;
+  pthread_mutex_unlock( &resolved_profiles_mutex );
+
+  /* the first scan records the files Oyranos has just read */
+  if(first)
+    return 0;
+
+  if(full)
+  {
+    pthread_mutex_lock( &oy_mutex );
+    oyGetPersistentStrings( NULL );
+    pthread_mutex_unlock( &oy_mutex );
+    return 2;
+  }
+
+  if(changed)
+  {
+    pthread_mutex_lock( &oy_mutex );
+    for(int i = 0; oy_db_keys[i]; ++i)
+      oyGetPersistentStrings( oy_db_keys[i] );
+    pthread_mutex_unlock( &oy_mutex );
+    return 1;
+  }
+
+  return 0;
+}
+
+/**
+ * Resolved monitor profiles, stored across sessions in
+ * $XDG_CACHE_HOME/compicc/profiles. Each line holds the monitor id, the
+ * Oyranos configuration fingerprint, the profile MD5 and the profile path.
+ * Entries with another fingerprint are ignored and dropped on save.
+ */
+#define RESOLVED_PROFILES_MAX 32
+typedef struct {
+  uint8_t id[16];
+  uint8_t policy[16];
+  uint8_t md5[16];
+  char * path;
+} PrivResolvedProfile;
 
-        error = oyConversion_RunPixels( cc, 0 );
+static PrivResolvedProfile resolved_profiles[RESOLVED_PROFILES_MAX];
+static int resolved_profiles_n = 0,
+           resolved_profiles_loaded = 0,
+           resolved_profiles_dirty = 0;
 
-        if(error)
-        {
-          oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
-                      DBG_STRING "oyConversion_RunPixels() error: %d %s",
-                      DBG_ARGS, error, ccontext->output_name);
-          goto clean_setupColourTable;
-        }
+static void md5Hex( const uint8_t md5[16], char hex[33] )
+{
+  for(int i = 0; i < 16; ++i)
+    sprintf( &hex[2*i], "%02x", md5[i] );
+}
 
-        ptr = (int**)oyArray2d_GetData(clut);
-        memcpy( ptr[0], ccontext->clut,
-                sizeof(GLushort) * GRIDPOINTS*GRIDPOINTS*GRIDPOINTS * 3 );
+static int md5FromHex( const char * hex, uint8_t md5[16] )
+{
+  for(int i = 0; i < 16; ++i)
+  {
+    unsigned int v;
+    if(sscanf( &hex[2*i], "%2x", &v ) != 1)
+      return 1;
+    md5[i] = v;
+  }
+  return 0;
+}
 
-        oyHash_SetPointer( entry, (oyStruct_s*) clut );
+/* returned string is owned by the caller */
+static char * resolvedProfilesPath( int dir_only )
+{
+  const char * cache = getenv("XDG_CACHE_HOME"),
+             * home = getenv("HOME");
+  char * path = NULL;
+
+  if(cache && cache[0])
+    oyStringAddPrintf( &path, malloc, free, "%s/compicc%s", cache,
+                       dir_only ? "" : "/profiles" );
+  else if(home && home[0])
+    oyStringAddPrintf( &path, malloc, free, "%s/.cache/compicc%s", home,
+                       dir_only ? "" : "/profiles" );
+  return path;
+}
 
-        if(oy_debug >= 2)
-        {
-          char * fn = 0;
-          static int c = 0;
-          oyStringAddPrintf( &fn, malloc, free, "dbg-clut-%d.ppm", c);
-          oyImage_WritePPM(image_out, fn, hash_text);
-          free(fn); fn = 0;
-          oyStringAddPrintf( &fn, malloc, free, "dbg-clut-%d.icc", c++);
-          FILE*fp=fopen(fn,"w");
-          if(fp) fwrite( oyBlob_GetPointer( blob ), sizeof(char), oyBlob_GetSize( blob ), fp );
-          if(fp) fclose(fp);
-        }
-      }
+/* call with resolved_profiles_mutex locked */
+static void loadResolvedProfiles( void )
+{
+  char * path = resolvedProfilesPath( 0 );
+  char id[33], policy[33], md5[33], file[4096];
+  FILE * fp = path ? fopen( path, "r" ) : NULL;
 
-      if(hash_text)
-      {
-        cicc_free(hash_text); hash_text = 0;
-      }
+  resolved_profiles_loaded = 1;
+  while(fp && resolved_profiles_n < RESOLVED_PROFILES_MAX &&
+        fscanf( fp, "%32s %32s %32s %4095[^\n]\n", id, policy, md5, file ) == 4)
+  {
+    PrivResolvedProfile * e = &resolved_profiles[resolved_profiles_n];
+    if(md5FromHex( id, e->id ) || md5FromHex( policy, e->policy ) ||
+       md5FromHex( md5, e->md5 ))
+      continue;
+    e->path = strdup( file );
+    ++resolved_profiles_n;
+  }
+  if(fp) fclose( fp );
+  if(path) free( path );
+}
 
+/**
+ * Renew oy_policy_fingerprint with a new profile directories stamp, once
+ * after each refreshOyranosDB(). The walk runs on the output job threads.
+ * Call with resolved_profiles_mutex locked.
+ */
+static void updatePolicyFingerprint( void )
+{
+  uint8_t v[16 + sizeof(long long)];
+  long long profiles;
 
-      oyOptions_Release( &options );
-      oyImage_Release( &image_in );
-      oyImage_Release( &image_out );
-      oyConversion_Release( &cc );
+  if(!oy_profile_dirs_stale)
+    return;
 
-      cdCreateTexture( ccontext );
+  profiles = profileDirsStamp();
+  memcpy( v, oy_db_fingerprint, 16 );
+  memcpy( v + 16, &profiles, sizeof(profiles) );
+  oyMiscBlobGetMD5_( v, sizeof(v), oy_policy_fingerprint );
+  oy_profile_dirs_stale = 0;
+}
 
-    }
+/**
+ * Look up the profile resolved for a monitor under the current Oyranos
+ * configuration. The profile file must still have the stored MD5.
+ */
+static oyProfile_s * lookupResolvedProfile( const uint8_t id[16] )
+{
+  oyProfile_s * profile = NULL;
+  char * path = NULL;
+  uint8_t md5[16];
 
-    if(!ccontext->dst_profile)
+  pthread_mutex_lock( &resolved_profiles_mutex );
+  if(!resolved_profiles_loaded)
+    loadResolvedProfiles();
+  updatePolicyFingerprint();
+  for(int i = 0; i < resolved_profiles_n; ++i)
+    if(memcmp( resolved_profiles[i].id, id, 16 ) == 0 &&
+       memcmp( resolved_profiles[i].policy, oy_policy_fingerprint, 16 ) == 0)
     {
-      oyCompLogMessage( NULL, "compicc", CompLogLevelInfo,
-                      DBG_STRING "Output \"%s\": no profile",
-                      DBG_ARGS, ccontext->output_name);
+      path = strdup( resolved_profiles[i].path );
+      memcpy( md5, resolved_profiles[i].md5, 16 );
+      break;
     }
+  pthread_mutex_unlock( &resolved_profiles_mutex );
 
-    clean_setupColourTable:
-    if(web)
-      oyProfile_Release( &web );
+  if(path)
+  {
+    uint8_t file_md5[16];
+    int flags = iccProfileFlags();
+    pthread_mutex_lock( &oy_mutex );
+    profile = oyProfile_FromFile( path, flags, 0 );
+    pthread_mutex_unlock( &oy_mutex );
+    if(profile &&
+       (oyProfile_GetMD5( profile, 0, (uint32_t*)file_md5 ) ||
+        memcmp( md5, file_md5, 16 ) != 0))
+      oyProfile_Release( &profile );
+    free( path );
+  }
+
+  return profile;
 }
 
-static int     getDisplayAdvanced    ( CompScreen        * s,
-                                       int                 screen OY_UNUSED )
+/**
+ * Remember a searched monitor profile. Profiles without file, e.g.
+ * generated in memory from EDID, are not stored.
+ */
+static void    storeResolvedProfile  ( const uint8_t       id[16],
+                                       oyProfile_s       * profile )
 {
-  CompDisplay * d = s->display;
-  PrivDisplay * pd = compObjectGetPrivate((CompObject *) d);
-  unsigned long nBytes;
-  char * opt = 0;
-  int advanced = 0;
-  Window root = RootWindow( s->display->display, 0 );
+  const char * file = oyProfile_GetFileName( profile, -1 );
+  uint8_t md5[16];
+  int i;
 
-  /* optionally set advanced options from Oyranos */
-  opt = fetchProperty( s->display->display, root, pd->iccDisplayAdvanced,
-                       XA_STRING, &nBytes, False );
-  if(oy_debug)
-        printf( DBG_STRING "iccDisplayAdvanced: %s %lu\n",
-                DBG_ARGS, opt?opt:"", nBytes);
-  if(opt && nBytes && atoi(opt) > 0)
-        advanced = atoi(opt);
-  if(opt)
-  {     XFree( opt ); opt = 0; }
+  if(!file || !file[0] || oyProfile_GetMD5( profile, 0, (uint32_t*)md5 ))
+    return;
 
-  return advanced;
+  pthread_mutex_lock( &resolved_profiles_mutex );
+  if(!resolved_profiles_loaded)
+    loadResolvedProfiles();
+  updatePolicyFingerprint();
+  for(i = 0; i < resolved_profiles_n; ++i)
+    if(memcmp( resolved_profiles[i].id, id, 16 ) == 0)
+      break;
+  if(i == RESOLVED_PROFILES_MAX)
+  {
+    /* drop the oldest entry */
+    free( resolved_profiles[0].path );
+    memmove( &resolved_profiles[0], &resolved_profiles[1],
+             (RESOLVED_PROFILES_MAX - 1) * sizeof(PrivResolvedProfile) );
+    i = --resolved_profiles_n;
+  }
+  if(i == resolved_profiles_n)
+    ++resolved_profiles_n;
+  else
+    free( resolved_profiles[i].path );
+
+  memcpy( resolved_profiles[i].id, id, 16 );
+  memcpy( resolved_profiles[i].policy, oy_policy_fingerprint, 16 );
+  memcpy( resolved_profiles[i].md5, md5, 16 );
+  resolved_profiles[i].path = strdup( file );
+  resolved_profiles_dirty = 1;
+  pthread_mutex_unlock( &resolved_profiles_mutex );
 }
 
-static void    setupOutputTable      ( CompScreen        * s,
-                                       oyConfig_s        * device OY_UNUSED,
+/**
+ * Write the resolved profiles, after they changed. Outdated entries are
+ * left out.
+ */
+static void    saveResolvedProfiles  ( void )
+{
+  char * dir, * path, * tmp = NULL;
+  FILE * fp;
+  int error = 0;
+
+  pthread_mutex_lock( &resolved_profiles_mutex );
+  if(!resolved_profiles_dirty)
+  {
+    pthread_mutex_unlock( &resolved_profiles_mutex );
+    return;
+  }
+
+  dir = resolvedProfilesPath( 1 );
+  path = resolvedProfilesPath( 0 );
+  if(dir)
+    mkdir( dir, 0700 );
+  /* write a new file and replace the old one, so readers never see a part */
+  if(path)
+    oyStringAddPrintf( &tmp, malloc, free, "%s.%d", path, (int)getpid() );
+  fp = tmp ? fopen( tmp, "w" ) : NULL;
+  for(int i = 0; fp && i < resolved_profiles_n; ++i)
+  {
+    char id[33], policy[33], md5[33];
+    if(memcmp( resolved_profiles[i].policy, oy_policy_fingerprint, 16 ) != 0)
+      continue;
+    md5Hex( resolved_profiles[i].id, id );
+    md5Hex( resolved_profiles[i].policy, policy );
+    md5Hex( resolved_profiles[i].md5, md5 );
+    fprintf( fp, "%s %s %s %s\n", id, policy, md5, resolved_profiles[i].path );
+  }
+  if(fp)
+  {
+    error = ferror( fp );
+    error = fclose( fp ) || error;
+    if(!error)
+      error = rename( tmp, path );
+    if(error)
+      unlink( tmp );
+  } else
+    error = 1;
+
+  /* a failed write is tried again with the next save */
+  if(!error)
+    resolved_profiles_dirty = 0;
+  else
+    oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "can not write %s", DBG_ARGS,
+                      path ? path : "----" );
+  pthread_mutex_unlock( &resolved_profiles_mutex );
+
+  if(dir) free( dir );
+  if(path) free( path );
+  if(tmp) free( tmp );
+}
+
+/**
+ * Query the monitor devices from Oyranos and announce the colour server.
+ * This is the expensive start of updateOutputConfiguration().
+ *
+ * @return                             the devices, to be released by the caller
+ */
+static oyConfigs_s * getOutputDevices( CompScreen        * s,
+                                       PrivScreen        * ps,
+                                       CompBool            init,
                                        int                 screen )
 {
-  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
-  PrivColorOutput * output = &ps->contexts[screen];
+  int error = 0;
+  oyConfigs_s * devices = 0;
 
+  /* allow Oyranos to see modifications made to the compiz Xlib context */
+  XFlush( s->display->display );
 
-  if(!colour_desktop_can)
-    return;
+  /* see new DB values */
+  refreshOyranosDB();
+  if(oy_debug)
+        printf( DBG_STRING "refreshed Oyranos DB cache init: %d screen: %d\n",
+                DBG_ARGS, init, screen );
 
+  /* Reuse the enumeration of needUpdate(). Without init the devices are
+   * only needed for indexing, so any previous enumeration fits. */
+  if(!old_devices || (init && !old_devices_fresh))
+  {
+    oyConfigs_Release( &old_devices );
+    old_devices = enumerateDevices( s->display->display );
+  }
+  devices = oyConfigs_Copy( old_devices, 0 );
+  /* used up; a later init needs a new enumeration */
+  old_devices_fresh = 0;
 
-  output->cc.src_profile = oyProfile_FromStd( oyASSUMED_WEB, icc_profile_flags, 0 );
-  output->cc.output_name = strdup(output->name);
-  if(!output->cc.src_profile)
-    oyCompLogMessage(s->display, "compicc", CompLogLevelWarn,
-             DBG_STRING "Output %s: no oyASSUMED_WEB src_profile",
-             DBG_ARGS, output->name );
+  if(colour_desktop_can && !init)
+  {
+    // set _ICC_COLOR_DESKTOP in advance to handle vcgt correctly
+    error = updateIccColorDesktopAtom( s, ps, 2 );
+    oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "updateIccColorDesktopAtom() status: %d",
+                      DBG_ARGS, error);
+  }
+
+  if(colour_desktop_can && init)
+  {
+    // set _ICC_COLOR_DESKTOP before to unset vcgt correctly
+    error = updateIccColorDesktopAtom( s, ps, 2 );
+    oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "updateIccColorDesktopAtom() status: %d",
+                      DBG_ARGS, error);
+  }
 
-  setupColourTable( &output->cc, getDisplayAdvanced( s, screen ), s );
+  return devices;
 }
 
-static void freeOutput( PrivScreen *ps )
+/**
+ * Identify a monitor by its EDID or, without EDID, by its connector name.
+ *
+ * @return                             - 0  id is set
+ *                                     - 1  unknown
+ */
+static int     deviceId              ( oyConfig_s        * device,
+                                       uint8_t             id[16] )
+{
+  const char * key = oyOptions_FindString( *oyConfig_GetOptions(device,"backend_core"),"EDID",0 );
+
+  memset( id, 0, 16 );
+  if(!key || !key[0])
+    key = oyConfig_FindString( device, "device_name", 0 );
+  if(!key || !key[0])
+    return 1;
+
+  oyMiscBlobGetMD5_( (void*) key, strlen(key), id );
+  return 0;
+}
+
+/**
+ * Match the new outputs against the previous configuration. Monitors,
+ * which are still connected, keep their profile, CLUT and texture and are
+ * skipped by configureOutputs(). Unmatched old outputs are freed.
+ *
+ * @return                             number of taken over outputs
+ */
+static int     adoptOutputs          ( CompScreen        * s,
+                                       PrivScreen        * ps,
+                                       oyConfigs_s       * devices )
 {
-  if (ps->nContexts > 0)
+  int n = 0;
+
+  for (unsigned long i = 0; i < ps->nContexts; ++i)
   {
-    for (unsigned long i = 0; i < ps->nContexts; ++i)
+    PrivColorOutput * output = &ps->contexts[i];
+    oyConfig_s * device = oyConfigs_Get( devices, i );
+
+    output->identified = deviceId( device, output->id ) == 0;
+
+    for (unsigned long j = 0; output->identified && j < ps->nOldContexts; ++j)
     {
-      if(ps->contexts[i].cc.dst_profile)
-        oyProfile_Release( &ps->contexts[i].cc.dst_profile );
-      if(ps->contexts[i].cc.glTexture)
-        glDeleteTextures( 1, &ps->contexts[i].cc.glTexture );
-      ps->contexts[i].cc.glTexture = 0;
+      PrivColorOutput * old = &ps->oldContexts[j];
+      int pending = old->cc.upload_pending;
+
+      if(!old->identified || memcmp( old->id, output->id, 16 ) != 0 ||
+         !(old->draw->texture.glTexture || pending))
+        continue;
+
+      unqueueUpload( ps, &old->cc );
+      memcpy( output, old, sizeof(PrivColorOutput) );
+      output->draw = &ps->draw[i];
+      output->draw->texture = old->draw->texture;
+      output->cc.texture = &output->draw->texture;
+      /* now owned by the new output */
+      old->cc.src_profile = old->cc.dst_profile = NULL;
+      old->cc.output_name = NULL;
+      old->cc.clut = NULL;
+      old->cc.cache = NULL;
+      old->draw->texture.glTexture = 0;
+      old->identified = 0;
+
+      output->cc.output = i;
+      output->keep = j == i ? 1 : 2;
+      getDeviceGeometry( s, output, device, i );
+      if(pending)
+        queueUpload( s, &output->cc );
+
+      oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                        DBG_STRING "keeping output %s %lu -> %lu",
+                        DBG_ARGS, output->name, j, i );
+      ++n;
+      break;
     }
-    cicc_free(ps->contexts);
+
+    oyConfig_Release( &device );
   }
+
+  freeOutputContexts( ps, ps->oldContexts, ps->oldDraw, ps->nOldContexts );
+  ps->oldContexts = NULL;
+  ps->oldDraw = NULL;
+  ps->nOldContexts = 0;
+
+  return n;
 }
 
+static void outputJobRun( PrivJob * job )
+{
+  if(job->init && !job->error)
+  {
+    job->error = askDeviceProfile( job->name,
+                                   job->identified ? job->id : NULL,
+                                   job->device, &job->work.dst_profile );
+    if(job->error > 0)
+        oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
+                    DBG_STRING "getDeviceProfile() error: %d",
+                    DBG_ARGS, job->error);
+  }
 
-void cleanDisplayProfiles( CompScreen *s )
+  if(job->build)
+    job->clut = setupColourTable( &job->work, job->advanced, &job->cancelled );
+}
+
+/**
+ * Pass a new output profile on to the region contexts, which waited for it.
+ */
+static void outputReady( CompWindow * w, void * closure )
 {
-    oyOptions_s * opts = 0,
-                * result = 0;
+  PrivWindow * pw = compObjectGetPrivate((CompObject *) w);
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) w->screen);
+  unsigned long i = *(unsigned long*)closure;
+  int advanced = -1;
 
-    const char * display_name = strdup(XDisplayString(s->display->display));
+  for(unsigned long k = 0; k < pw->nRegions; ++k)
+  {
+    PrivColorRegion * r = &pw->pRegion[k];
+    PrivColorContext * cc;
 
-    oyOptions_SetFromString( &opts, "////display_name",
-                           display_name, OY_CREATE_NEW );
-    oyOptions_Handle( "//" OY_TYPE_STD "/clean_profiles",
-                                opts,"clean_profiles",
-                                &result );
-    return;
+    if(!r->cc || i >= r->nCc || !r->cc[i])
+      continue;
+    cc = r->cc[i];
+    if(cc->dst_profile || cc->job || !cc->src_profile)
+      continue;
+
+    cc->dst_profile = oyProfile_Copy( ps->contexts[i].cc.dst_profile, 0 );
+    if(advanced < 0)
+      advanced = getDisplayAdvanced( w->screen, 0 );
+    buildRegionContext( w->screen, cc, advanced );
+  }
 }
 
 /**
- * Called when output configuration (or properties) change.
+ * An output job finished: upload, damage on change and, after the last
+ * output job, move the profile atoms of all outputs in one batch.
  */
-static void setupOutputs(CompScreen *s)
+static void outputJobDone( PrivJob * job )
 {
-  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
-  int n;
-  CompDisplay * d = s->display;
+  CompScreen * s = job->s;
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
+  PrivColorOutput * output = job->output;
+  unsigned long i = job->i;
 
-  /* clean memory */
+  --ps->nOutputJobs;
+
+  if(output->cc.dst_profile)
   {
-    freeOutput(ps);
+    output->movePending = 1;
+    forEachWindowOnScreen( s, outputReady, &i );
+  } else
+  {
+    oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                DBG_STRING "No profile found on desktops %d/%d 0x%lx 0x%lx",
+                DBG_ARGS, i, ps->nContexts, output, output->cc.dst_profile);
+  }
+  if(job->init)
+    ps->saveResolved = 1;
 
-    cleanDisplayProfiles( s );
+  if(job->clut == 0)
+    queueUpload( s, &output->cc );
+
+  if(memcmp( job->transform_md5, output->cc.transform_md5, 16 ) != 0 ||
+     memcmp( &job->xRect, &output->draw->xRect, sizeof(XRectangle) ) != 0)
+  {
+    PrivDamageOutputs damage = { 1, &output->draw->xRect };
+    forEachWindowOnScreen( s, damageWindowOutputs, &damage );
+    oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
+                DBG_STRING "output %lu changed, damaging %dx%d+%d+%d",
+                DBG_ARGS, i, output->draw->xRect.width,
+                output->draw->xRect.height, output->draw->xRect.x,
+                output->draw->xRect.y );
   }
 
-  n = s->nOutputDev;
+  if(ps->nOutputJobs)
+    return;
 
-  oyCompLogMessage(d, "compicc", CompLogLevelDebug, DBG_STRING "nOutputDev: %d", DBG_ARGS, n );
   {
-    int i;
-    ps->nContexts = n;
-    ps->contexts = (PrivColorOutput*)cicc_alloc( ps->nContexts *
-                                             sizeof(PrivColorOutput ));
-    for(i = 0; i < n; ++i)
-      ps->contexts[i].cc.ref = 1;
+    int * moves = cicc_alloc( ps->nContexts * sizeof(int) ),
+        nMoves = 0;
+    for(unsigned long k = 0; moves && k < ps->nContexts; ++k)
+      if(ps->contexts[k].movePending)
+      {
+        moves[nMoves++] = k;
+        ps->contexts[k].movePending = 0;
+      }
+    moveICCprofileAtoms( s, moves, nMoves, 1 );
+    if(moves)
+      cicc_free( moves );
   }
 
-  /* allow Oyranos to see modifications made to the compiz Xlib context */
-  XFlush( s->display->display );
+  if(ps->saveResolved)
+    saveResolvedProfiles();
+  ps->saveResolved = 0;
 }
 
-oyConfigs_s * old_devices = NULL;
-int            needUpdate            ( Display           * display )
+/**
+ * Resolve the profiles of the outputs and build their colour transforms.
+ * Property reads are done here. The Oyranos side of each output runs as
+ * a worker job; outputJobDone() uploads, damages and moves the atoms.
+ *
+ * @param[in]      screen              the output or -1 for all
+ */
+static void    configureOutputs      ( CompScreen        * s,
+                                       PrivScreen        * ps,
+                                       oyConfigs_s       * devices,
+                                       CompBool            init,
+                                       int                 screen )
 {
-  int error = 0,
-      i, n, update = 0;
-  oyOptions_s * options = 0;
-  oyConfigs_s * devices = 0;
-  oyConfig_s * device = 0, * old_device = 0;
+  int advanced,
+      * moves, nMoves = 0;
+
+  if(!ps->nContexts)
+    return;
+
+  moves = cicc_alloc( ps->nContexts * sizeof(int) );
+  if(!moves)
+    return;
+
+  advanced = getDisplayAdvanced( s, screen );
+
+  for (unsigned long i = 0; i < ps->nContexts; ++i)
+  {
+    PrivJob * job;
+
+    if( screen >= 0 && (int)i != screen )
+      continue;
+
+    /* taken over from the previous configuration */
+    if(init && ps->contexts[i].keep)
+    {
+      if(ps->contexts[i].keep == 2)
+        moves[nMoves++] = i;
+      ps->contexts[i].keep = 0;
+      continue;
+    }
+
+    /* the context is written below */
+    cancelJob( ps->contexts[i].cc.job );
+
+    job = newJob( s, &ps->contexts[i].cc, outputJobRun, outputJobDone );
+    if(!job)
+      continue;
+    job->output = &ps->contexts[i];
+    job->i = i;
+    memcpy( job->name, ps->contexts[i].name, sizeof(job->name) );
+    memcpy( job->id, ps->contexts[i].id, 16 );
+    job->identified = ps->contexts[i].identified;
+    job->init = init;
+    job->advanced = advanced;
+    job->build = colour_desktop_can;
+    memcpy( job->transform_md5, ps->contexts[i].cc.transform_md5, 16 );
+    job->xRect = ps->draw[i].xRect;
+    job->device = oyConfigs_Get( devices, i );
+
+    if(init)
+      job->error = getDeviceProfile( s, ps, job->device, i );
+
+    setupOutputTable( s, i );
+
+    submitJob( job );
+  }
 
+  moveICCprofileAtoms( s, moves, nMoves, 1 );
 
-  /* allow Oyranos to see modifications made to the compiz Xlib context */
-  XFlush( display );
+  cicc_free( moves );
+}
 
-  /* obtain device informations, including geometry and ICC profiles
-     from the according Oyranos module */
-  error = oyOptions_SetFromString( &options, "//" OY_TYPE_STD "/config/command",
-                                 "list", OY_CREATE_NEW );
-  if(error) fprintf(stdout,"%s %d", "found issues",error);
-  error = oyOptions_SetFromString( &options, "//" OY_TYPE_STD "/config/device_rectangle",
-                                 "true", OY_CREATE_NEW );
-  if(error) fprintf(stdout,"%s %d", "found issues",error);
-  error = oyOptions_SetFromString( &options, "//" OY_TYPE_STD "/config/edid",
-                                 "refresh", OY_CREATE_NEW );
-  error = oyDevicesGet( OY_TYPE_STD, "monitor", options, &devices );
-  if(error) fprintf(stdout,"%s %d", "found issues",error);
-  n = oyOptions_Count( options );
-  oyOptions_Release( &options );
+static void updateOutputConfiguration(CompScreen *s, CompBool init, int screen)
+{
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
+  oyConfigs_s * devices = getOutputDevices( s, ps, init, screen );
 
-  n = oyConfigs_Count( devices );
-  /* find out if monitors have changed at all
-   * care only about EDID's and enumeration, no dimension */
-  if(n != oyConfigs_Count( old_devices ))
-    update = 1;
-  else
-  for(i = 0; i < n; ++i)
-  {
-    const char * edid, * old_edid, * rect, * old_rect;
-    device = oyConfigs_Get( devices, i );
-    old_device = oyConfigs_Get( old_devices, i );
-    edid = oyOptions_FindString( *oyConfig_GetOptions(device,"backend_core"),"EDID",0 );
-    old_edid = oyOptions_FindString( *oyConfig_GetOptions(old_device,"backend_core"),"EDID",0 );
-    rect = oyOptions_FindString( *oyConfig_GetOptions(device,"backend_core"),"display_geometry",0 );
-    old_rect = oyOptions_FindString( *oyConfig_GetOptions(old_device,"backend_core"),"display_geometry",0 );
+  if(colour_desktop_can)
+    configureOutputs( s, ps, devices, init, screen );
+  oyConfigs_Release( &devices );
+}
 
-    if(edid && old_edid && strcmp(edid,old_edid)==0 && strcmp(rect,old_rect)==0)
-      update = 0;
-    else
-      update = 1;
+/**
+ * One step of the output setup after activation or output changes.
+ * The first step queries the devices, the second swaps in the new output
+ * array, takes over unchanged monitors and configures the others.
+ * Until the swap the configured outputs stay in place, so monitors which
+ * survive are drawn corrected throughout.
+ *
+ * @return                             TRUE to be called again
+ */
+static Bool setupOutputStep( void * closure )
+{
+  CompScreen * s = closure;
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
 
-    oyConfig_Release( &device );
-    oyConfig_Release( &old_device );
-    if(update) break;
+  if(ps->setupStep == SETUP_DEVICES)
+  {
+    ps->setupDevices = getOutputDevices( s, ps, TRUE, -1 );
+    ps->setupStep = SETUP_OUTPUTS;
+    return TRUE;
   }
 
-  oyConfigs_Release( &old_devices );
-  old_devices = devices;
+  setupOutputs( s );
 
-  fprintf( stderr,"%s:%d %s() update: %d\n", __FILE__, __LINE__, __func__, update);
-  return update;
+  /* a full reset only, when no monitor stayed */
+  if(!adoptOutputs( s, ps, ps->setupDevices ))
+    cleanDisplayProfiles( s );
+
+  if(colour_desktop_can)
+    configureOutputs( s, ps, ps->setupDevices, TRUE, -1 );
+
+  oyConfigs_Release( &ps->setupDevices );
+  ps->setupStep = SETUP_IDLE;
+  ps->setupTimeout = 0;
+
+  struct timeval now;
+  gettimeofday( &now, NULL );
+  oyCompLogMessage( s->display, "compicc", CompLogLevelInfo,
+                    DBG_STRING "setup of %lu outputs: %ld ms", DBG_ARGS,
+                    ps->nContexts,
+                    (long)(now.tv_sec - ps->setupStart.tv_sec) * 1000 +
+                    (now.tv_usec - ps->setupStart.tv_usec) / 1000 );
+  /* without pending jobs or uploads there is no later ready time to report */
+  if(!ps->nJobs && !ps->nUploads)
+    ps->setupStart.tv_sec = 0;
+  return FALSE;
 }
 
 /**
- * Called when XRandR output configuration (or properties) change. Fetch
- * output profiles (if available) or fall back to sRGB.
- * Device profiles are obtained from Oyranos only once at beginning.
+ * (Re-)start the output setup. The outputs are replaced and all Oyranos
+ * work runs in setupOutputStep() from the main loop.
  */
-static void updateOutputConfiguration(CompScreen *s, CompBool init, int screen)
+static void startOutputSetup( CompScreen * s )
 {
-  PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
-  int error = 0,
-      set = 1;
-  oyOptions_s * options = 0;
-  oyConfigs_s * devices = 0;
-  oyConfig_s * device = 0;
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
 
-  /* allow Oyranos to see modifications made to the compiz Xlib context */
-  XFlush( s->display->display );
+  cancelOutputSetup( ps );
 
-  /* reset Oyranos DB cache to see new DB values */
-  oyGetPersistentStrings( NULL );
-  if(oy_debug)
-        printf( DBG_STRING "resetted Oyranos DB cache init: %d screen: %d\n",
-                DBG_ARGS, init, screen );
+  gettimeofday( &ps->setupStart, NULL );
+  ps->setupStep = SETUP_DEVICES;
+  ps->setupTimeout = compAddTimeout( 0, 0, setupOutputStep, s );
+}
 
+static void cancelOutputSetup( PrivScreen * ps )
+{
+  if(ps->setupTimeout)
+    compRemoveTimeout( ps->setupTimeout );
+  ps->setupTimeout = 0;
+  ps->setupStep = SETUP_IDLE;
+  oyConfigs_Release( &ps->setupDevices );
+}
 
-  /* obtain device informations, including geometry and ICC profiles
-     from the according Oyranos module */
-  error = oyOptions_SetFromString( &options, "//" OY_TYPE_STD "/config/command",
-                                 "list", OY_CREATE_NEW );
-  error = oyOptions_SetFromString( &options, "//" OY_TYPE_STD "/config/device_rectangle",
-                                 "true", OY_CREATE_NEW );
-  error = oyDevicesGet( OY_TYPE_STD, "monitor", options, &devices );
-  if(error > 0)
-          oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
-                      DBG_STRING "oyDevicesGet() error: %d",
-                      DBG_ARGS, error);
-  oyOptions_Release( &options );
 
-  if(colour_desktop_can && !init)
-  {
-    // set _ICC_COLOR_DESKTOP in advance to handle vcgt correctly
-    error = updateIccColorDesktopAtom( s, ps, 2 );
-    oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
-                      DBG_STRING "updateIccColorDesktopAtom() status: %d",
-                      DBG_ARGS, error);
-  }
 
-  if(colour_desktop_can && init)
+/* add the tokens for the time since the last refill */
+static void    rateLimitRefill       ( PrivRateLimit     * rl )
+{
+  struct timeval now;
+  double dt;
+
+  gettimeofday( &now, NULL );
+  dt = (now.tv_sec - rl->last.tv_sec) +
+       (now.tv_usec - rl->last.tv_usec) / 1000000.0;
+  if(rl->last.tv_sec == 0)
+    rl->tokens = RATE_LIMIT_BURST;
+  else
+    rl->tokens += dt * RATE_LIMIT_RATE;
+  if(rl->tokens > RATE_LIMIT_BURST)
+    rl->tokens = RATE_LIMIT_BURST;
+  rl->last = now;
+}
+
+/**
+ * Take a token from the bucket or schedule a deferred update.
+ * The first deferral of a window is reported, later ones only at debug level.
+ *
+ * @return                             - 1  apply the update now
+ *                                     - 0  the update is folded into
+ *                                          a deferred call of cb
+ */
+static int     rateLimitAllow        ( PrivRateLimit     * rl,
+                                       CallBackProc        cb,
+                                       void              * closure,
+                                       const char        * property,
+                                       Window              window )
+{
+  rateLimitRefill( rl );
+
+  /* keep the order with a already pending update */
+  if(!rl->deferred && rl->tokens >= 1.0)
   {
-    // set _ICC_COLOR_DESKTOP before to unset vcgt correctly
-    error = updateIccColorDesktopAtom( s, ps, 2 );
-    oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
-                      DBG_STRING "updateIccColorDesktopAtom() status: %d",
-                      DBG_ARGS, error);
+    rl->tokens -= 1.0;
+    return 1;
   }
 
-  if(colour_desktop_can)
-  for (unsigned long i = 0; i < ps->nContexts; ++i)
+  if(!rl->deferred)
   {
-    if( screen >= 0 && (int)i != screen )
-      continue;
+    int ms = (1.0 - rl->tokens) * 1000 / RATE_LIMIT_RATE + 1;
+    CompLogLevel level = rl->reported ? CompLogLevelDebug : CompLogLevelWarn;
+    oyCompLogMessage( NULL, "compicc", level,
+                      DBG_STRING "throttling %s updates on window 0x%lx to %d/s",
+                      DBG_ARGS, property, window, RATE_LIMIT_RATE );
+    rl->reported = 1;
+    rl->deferred = compAddTimeout( ms, ms + ms / 2 + 1, cb, closure );
+    rl->folded = 0;
+  }
+  ++rl->folded;
 
-    device = oyConfigs_Get( devices, i );
+  return 0;
+}
 
-    if(init)
-    {
-      error = getDeviceProfile( s, ps, device, i );
-      if(error > 0)
-          oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
-                      DBG_STRING "getDeviceProfile() error: %d",
-                      DBG_ARGS, error);
-    }
+/* take the folded update out of the bucket */
+static void    rateLimitDone         ( PrivRateLimit     * rl,
+                                       const char        * property,
+                                       Window              window )
+{
+  if(rl->folded > 1)
+    oyCompLogMessage( NULL, "compicc", CompLogLevelDebug,
+                      DBG_STRING "folded %lu %s updates on window 0x%lx",
+                      DBG_ARGS, rl->folded, property, window );
+  rl->deferred = 0;
+  rl->folded = 0;
+  rateLimitRefill( rl );
+  rl->tokens -= 1.0;
+}
 
-    if(ps->contexts[i].cc.dst_profile)
-    {
-      moveICCprofileAtoms( s, i, set );
-    } else
-    {
-      oyCompLogMessage( s->display, "compicc", CompLogLevelDebug,
-                  DBG_STRING "No profile found on desktops %d/%d 0x%lx 0x%lx",
-                  DBG_ARGS, i, ps->nContexts, &ps->contexts[i],
-                  ps->contexts[i].cc.dst_profile);
-    }
+static void    rateLimitCancel       ( PrivRateLimit     * rl )
+{
+  if(rl->deferred)
+    compRemoveTimeout( rl->deferred );
+  rl->deferred = 0;
+}
 
-    setupOutputTable( s, device, i );
+static Bool    deferredWindowRegions ( void              * closure )
+{
+  CompWindow * w = closure;
+  PrivWindow * pw = compObjectGetPrivate((CompObject *) w);
 
-    oyConfig_Release( &device );
-  }
-  oyConfigs_Release( &devices );
+  rateLimitDone( &pw->regionsLimit, XCM_COLOR_REGIONS, w->id );
+  if(updateWindowRegions( w ) == 1)
+    colour_desktop_region_count = -1;
 
-  {
-    int all = 1;
-    forEachWindowOnScreen( s, damageWindow, &all );
-  }
+  return FALSE;
 }
 
+static Bool    deferredScreenProfiles( void              * closure )
+{
+  CompScreen * s = closure;
+  PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
+
+  rateLimitDone( &ps->profilesLimit, XCM_COLOR_PROFILES, s->root );
+  updateScreenProfiles( s );
 
+  return FALSE;
+}
 
 /**
  * CompDisplay::handleEvent
@@ -1557,7 +4568,7 @@ static void updateOutputConfiguration(CompScreen *s, CompBool init, int screen)
 static void pluginHandleEvent(CompDisplay *d, XEvent *event)
 {
   PrivDisplay *pd = compObjectGetPrivate((CompObject *) d);
-  const char * atom_name = 0;
+  int screen = -1;
 
   UNWRAP(pd, d, handleEvent);
   (*d->handleEvent) (d, event);
@@ -1566,68 +4577,90 @@ static void pluginHandleEvent(CompDisplay *d, XEvent *event)
   if(!colour_desktop_can)
     return;
 
+  /* rank waiting colour work for the new focus or visibility */
+  if(d->activeWindow != pd->activeWindow ||
+     event->type == MapNotify || event->type == UnmapNotify)
+  {
+    pd->activeWindow = d->activeWindow;
+    reprioritiseJobs( d );
+  }
+
   CompScreen * s = findScreenAtDisplay(d, event->xany.window);
   PrivScreen * ps = compObjectGetPrivate((CompObject *) s);
 
 
   switch (event->type)
   {
+  case SelectionClear:
+    /* an other colour server took over */
+    for(CompScreen * cs = d->screens; cs; cs = cs->next)
+    {
+      PrivScreen * cps = compObjectGetPrivate((CompObject *) cs);
+      if(cps->selectionWindow == event->xselectionclear.window &&
+         cps->colorDesktopSelection == event->xselectionclear.selection)
+      {
+        oyCompLogMessage( d, "compicc", CompLogLevelWarn,
+                    DBG_STRING "\nGiving colour service away on screen %d.",
+                    DBG_ARGS, cs->screenNum );
+        colour_desktop_can = 0;
+      }
+    }
+    if(!colour_desktop_can)
+      for(CompScreen * cs = d->screens; cs; cs = cs->next)
+        releaseOutputTextures( cs, compObjectGetPrivate((CompObject *) cs) );
+    break;
   case PropertyNotify:
-    atom_name = XGetAtomName( event->xany.display, event->xproperty.atom );
+    /* look up the output of a _ICC_PROFILE(_xxx) atom */
+    if(ps && ps->profileAtoms)
+      for(unsigned long i = 0; i < ps->nContexts; ++i)
+        if(event->xproperty.atom == ps->profileAtoms[i])
+          screen = i;
 
     if (event->xproperty.atom == pd->iccColorProfiles)
     {
       CompScreen *s = findScreenAtDisplay(d, event->xproperty.window);
-      updateScreenProfiles(s);
+      PrivScreen *ps = s ? compObjectGetPrivate((CompObject *) s) : NULL;
+      if(ps &&
+         rateLimitAllow( &ps->profilesLimit, deferredScreenProfiles, s,
+                         XCM_COLOR_PROFILES, event->xproperty.window ))
+        updateScreenProfiles(s);
     } else if (event->xproperty.atom == pd->iccColorRegions)
     {
       CompWindow *w = findWindowAtDisplay(d, event->xproperty.window);
-      updateWindowRegions(w);
-      colour_desktop_region_count = -1;
+      PrivWindow *pw = w ? compObjectGetPrivate((CompObject *) w) : NULL;
+      /* skip rewrites with unchanged content */
+      if(pw &&
+         rateLimitAllow( &pw->regionsLimit, deferredWindowRegions, w,
+                         XCM_COLOR_REGIONS, w->id ) &&
+         updateWindowRegions(w) == 1)
+        colour_desktop_region_count = -1;
     } else if (event->xproperty.atom == pd->iccColorOutputs)
     {
       CompWindow *w = findWindowAtDisplay(d, event->xproperty.window);
       updateWindowOutput(w);
 
     /* let possibly others take over the colour server */
-    } else if( event->xproperty.atom == pd->iccColorDesktop && atom_name )
+    } else if( event->xproperty.atom == pd->iccColorDesktop )
     {
       updateIccColorDesktopAtom( s, ps, 0 );
 
     /* update for a changing monitor profile */
-    } else if(
-           strstr( atom_name, XCM_ICC_V0_3_TARGET_PROFILE_IN_X_BASE) != 0/* &&
-           strstr( atom_name, "ICC_PROFILE_IN_X") == 0*/ )
+    } else if( screen >= 0 )
     {
       if(colour_desktop_can)
       {
-        int screen = 0;
         int ignore_profile = 0;
-        char * icc_colour_server_profile_atom = (char*)cicc_alloc(1024);
-        char num[12];
-        Atom da;
-        unsigned long n = 0;
-
-        if(strlen(atom_name) > strlen(XCM_ICC_V0_3_TARGET_PROFILE_IN_X_BASE"_"))
-        sscanf( (const char*)atom_name,
-                XCM_ICC_V0_3_TARGET_PROFILE_IN_X_BASE "_%d", &screen );
-        snprintf( num, 12, "%d", screen );
-
-        snprintf( icc_colour_server_profile_atom, 1024,
-                  XCM_DEVICE_PROFILE"%s%s",
-                  screen ? "_" : "", screen ? num : "" );
-
-        da = XInternAtom( d->display, icc_colour_server_profile_atom, False);
+        Atom da = ps->deviceProfileAtoms[screen];
+        size_t n = 0;
 
         if(da)
         {
-          char * data = fetchProperty( d->display, RootWindow(d->display,0),
-                                       event->xproperty.atom, XA_CARDINAL,
-                                       &n, False);
-          if(data && n)
+          /* server p */
+          oyProfile_s * sp = profileFromProperty( d, RootWindow(d->display,0),
+                                                  event->xproperty.atom, &n );
+          if(sp && n)
           {
-            oyProfile_s * sp = oyProfile_FromMem( n, data, 0,0 ); /* server p */
-            oyProfile_s * web = oyProfile_FromStd( oyASSUMED_WEB, icc_profile_flags, 0 );
+            oyProfile_s * web = webProfile();
 
             /* The distinction of sRGB profiles set by the server and ones
              * coming from outside the colour server is rather fragile.
@@ -1646,8 +4679,10 @@ static void pluginHandleEvent(CompDisplay *d, XEvent *event)
             {
               if((int)ps->nContexts > screen)
               {
+                cancelJob( ps->contexts[screen].cc.job );
                 oyProfile_Release( &ps->contexts[screen].cc.dst_profile );
                 ps->contexts[screen].cc.dst_profile = sp;
+                sp = 0;
               } else
                 oyCompLogMessage( s->display, "compicc",CompLogLevelWarn,
                     DBG_STRING "contexts not ready for screen %d / %d",
@@ -1657,13 +4692,10 @@ static void pluginHandleEvent(CompDisplay *d, XEvent *event)
                                da, XA_CARDINAL,
                                (unsigned char*)NULL, 0 );
             }
-            sp = 0;
-            XFree( data );
           }
+          oyProfile_Release( &sp );
         }
 
-        if(icc_colour_server_profile_atom) cicc_free(icc_colour_server_profile_atom);
-
         if(!ignore_profile &&
            /* change only existing profiles, ignore removed ones */
            n)
@@ -1673,11 +4705,13 @@ static void pluginHandleEvent(CompDisplay *d, XEvent *event)
       }
 
     /* update for changing geometry */
-    } else if (event->xproperty.atom == pd->netDesktopGeometry &&
-               needUpdate(s->display->display))
+    } else if (event->xproperty.atom == pd->netDesktopGeometry)
     {
-      setupOutputs( s );
-      updateOutputConfiguration(s, TRUE, -1);
+      int update = needUpdate(s->display->display);
+      if(update == UPDATE_DEVICES)
+        startOutputSetup( s );
+      else if(update == UPDATE_GEOMETRY)
+        updateOutputGeometry( s );
     } else if (event->xproperty.atom == pd->iccDisplayAdvanced)
     {
       updateOutputConfiguration( s, FALSE, -1 );
@@ -1692,45 +4726,39 @@ static void pluginHandleEvent(CompDisplay *d, XEvent *event)
       if(rrn->subtype == RRNotify_OutputChange)
       {
         CompScreen *s = findScreenAtDisplay(d, rrn->window);
-        if(needUpdate(s->display->display))
-        {
-          setupOutputs( s );
-          updateOutputConfiguration(s, TRUE, -1);
-        }
+        int update = needUpdate(s->display->display);
+        if(update == UPDATE_DEVICES)
+          startOutputSetup( s );
+        else if(update == UPDATE_GEOMETRY)
+          updateOutputGeometry( s );
       }
     }
 #endif
     break;
   }
 
-  /* initialise */
-  if(s && ps && s->nOutputDev != (int)ps->nContexts)
-  {
-    setupOutputs( s );
-    updateOutputConfiguration( s, TRUE, -1);
-  }
+  /* initialise, after warmUpOyranos(); a pending setup swaps the outputs */
+  if(s && ps && oyranosReady() && ps->setupStep == SETUP_IDLE &&
+     s->nOutputDev != (int)ps->nContexts)
+    startOutputSetup( s );
 }
 
 /**
  * Make region relative to the window. 
- * Uses static variables to prevent
- * allocating and freeing the Region in pluginDrawWindow().
+ * Writes into a caller provided PrivRegion to prevent
+ * allocating and freeing memory in pluginDrawWindow().
  */
-static Region absoluteRegion(CompWindow *w, Region region)
+static void absoluteRegion(CompWindow *w, const PrivRegion *region, PrivRegion *abs)
 {
-  Region r = XCreateRegion();
-  XUnionRegion( region, r, r );
-
-  for (int i = 0; i < r->numRects; ++i) {
-    r->rects[i].x1 += w->attrib.x;
-    r->rects[i].x2 += w->attrib.x;
-    r->rects[i].y1 += w->attrib.y;
-    r->rects[i].y2 += w->attrib.y;
+  regionInit( abs );
+  if(regionReserve( abs, region->nBoxes ))
+    return;
 
-    EXTENTS(&r->rects[i], r);
-  }
+  memcpy( REGION_BOXES(abs), REGION_BOXES(region), region->nBoxes * sizeof(BOX) );
+  abs->nBoxes = region->nBoxes;
+  abs->extents = region->extents;
 
-  return r;
+  regionTranslate( abs, w->attrib.x, w->attrib.y );
 }
 
 static void damageWindow(CompWindow *w, void *closure)
@@ -1749,6 +4777,37 @@ static void damageWindow(CompWindow *w, void *closure)
   }
 }
 
+/**
+ * Damage the parts of a window, which are on the given output rectangles.
+ */
+static void damageWindowOutputs(CompWindow *w, void *closure)
+{
+  PrivWindow *pw = compObjectGetPrivate((CompObject *) w);
+  PrivDamageOutputs * damage = closure;
+
+  if(!pw || !pw->absoluteWindowRectangleOld)
+    return;
+
+  for(int i = 0; i < damage->n; ++i)
+  {
+    XRectangle * r = &damage->rects[i];
+    int x1 = w->serverX > r->x ? w->serverX : r->x,
+        y1 = w->serverY > r->y ? w->serverY : r->y,
+        x2 = w->serverX + w->serverWidth < r->x + r->width ?
+             w->serverX + w->serverWidth : r->x + r->width,
+        y2 = w->serverY + w->serverHeight < r->y + r->height ?
+             w->serverY + w->serverHeight : r->y + r->height;
+
+    if(x1 < x2 && y1 < y2)
+    {
+      /* addWindowDamageRect() expects window relative coordinates */
+      BOX box = { x1 - w->serverX, x2 - w->serverX,
+                  y1 - w->serverY, y2 - w->serverY };
+      addWindowDamageRect( w, &box );
+    }
+  }
+}
+
 static void addWindowRegionCount(CompWindow *w, void * var)
 {
   PrivWindow *pw = compObjectGetPrivate((CompObject *) w);
@@ -1782,12 +4841,6 @@ static Bool pluginDrawWindow(CompWindow *w, const CompTransform *transform, cons
   PrivScreen *ps = compObjectGetPrivate((CompObject *) s);
   unsigned long i,j;
 
-  /* check every 10 seconds */
-  time_t  cutime;         /* Time since epoch */
-  cutime = time(NULL);    /* current user time */
-  if((cutime - icc_color_desktop_last_time > (time_t)10))
-    updateIccColorDesktopAtom( s, ps, 0 );
-
   UNWRAP(ps, s, drawWindow);
   Bool status = (*s->drawWindow) (w, transform, attrib, region, mask);
   WRAP(ps, s, drawWindow, pluginDrawWindow);
@@ -1806,24 +4859,24 @@ static Bool pluginDrawWindow(CompWindow *w, const CompTransform *transform, cons
                            &colour_desktop_region_count );
   }
 
-  oyRectangle_s * rect = oyRectangle_NewWith( w->serverX, w->serverY,
-                                          w->serverWidth, w->serverHeight, 0 );
+  oyRectangle_s * old = pw->absoluteWindowRectangleOld;
 
   /* update to window movements and resizes */
-  if( !oyRectangle_IsEqual( rect, pw->absoluteWindowRectangleOld ) )
+  if(w->serverX != oyRectangle_GetGeo1( old, 0 ) ||
+     w->serverY != oyRectangle_GetGeo1( old, 1 ) ||
+     w->serverWidth != oyRectangle_GetGeo1( old, 2 ) ||
+     w->serverHeight != oyRectangle_GetGeo1( old, 3 ))
   {
     forEachWindowOnScreen(s, damageWindow, NULL);
 
-    if(w->serverWidth != oyRectangle_GetGeo1( pw->absoluteWindowRectangleOld, 2 ) ||
-       w->serverHeight != oyRectangle_GetGeo1( pw->absoluteWindowRectangleOld, 3 ))
+    if(w->serverWidth != oyRectangle_GetGeo1( old, 2 ) ||
+       w->serverHeight != oyRectangle_GetGeo1( old, 3 ))
       updateWindowRegions( w );
 
-    oyRectangle_SetByRectangle( pw->absoluteWindowRectangleOld, rect );
-
+    oyRectangle_SetGeo( old, w->serverX, w->serverY,
+                        w->serverWidth, w->serverHeight );
   }
 
-  oyRectangle_Release( &rect );
-
   /* skip the stencil drawing for to be scissored windows */
   if( !HAS_REGIONS(pw) )
     return status;
@@ -1840,7 +4893,8 @@ static Bool pluginDrawWindow(CompWindow *w, const CompTransform *transform, cons
   for( j = 0; j < pw->nRegions; ++j )
   {
     PrivColorRegion * window_region = pw->pRegion + j;
-    Region aRegion = absoluteRegion( w, window_region->xRegion);
+    PrivRegion aRegion;
+    absoluteRegion( w, &window_region->region, &aRegion );
 
     for( i = 0; i < ps->nContexts; ++i )
     {
@@ -1848,12 +4902,11 @@ static Bool pluginDrawWindow(CompWindow *w, const CompTransform *transform, cons
       glStencilFunc(GL_ALWAYS, STENCIL_ID, ~0);
 
       /* intersect window with monitor */
-      Region screen = XCreateRegion();
-      XUnionRectWithRegion( &ps->contexts[i].xRect, screen, screen );    
-      Region intersection = XCreateRegion();
-      XIntersectRegion( screen, aRegion, intersection );
-      BOX * b = &intersection->extents;
-      if(b->x1 == 0 && b->x2 == 0 && b->y1 == 0 && b->y2 == 0)
+      PrivRegion intersection;
+      REGION xIntersection;
+      regionInit( &intersection );
+      regionIntersectRect( &intersection, &aRegion, &ps->draw[i].xRect );
+      if(regionIsEmpty( &intersection ))
         goto cleanDrawWindow;
 
       if(oy_debug >= 3)
@@ -1861,7 +4914,9 @@ static Bool pluginDrawWindow(CompWindow *w, const CompTransform *transform, cons
                STENCIL_ID,colour_desktop_region_count,i,pw->stencil_id_start,j);
 
       w->vCount = w->indexCount = 0;
-      (*w->screen->addWindowGeometry) (w, &w->matrix, 1, intersection, region);
+      (*w->screen->addWindowGeometry) (w, &w->matrix, 1,
+                          regionToXRegion( &intersection, &xIntersection ),
+                          region);
 
       /* If the geometry is non-empty, draw the window */
       if (w->vCount > 0)
@@ -1872,11 +4927,10 @@ static Bool pluginDrawWindow(CompWindow *w, const CompTransform *transform, cons
       }
 
       cleanDrawWindow:
-      XDestroyRegion( intersection );
-      XDestroyRegion( screen );
+      regionFini( &intersection );
     }
 
-    XDestroyRegion( aRegion ); aRegion = 0;
+    regionFini( &aRegion );
   }
 
   /* Reset the color mask */
@@ -1932,35 +4986,36 @@ static void pluginDrawWindowTexture(CompWindow *w, CompTexture *texture, const F
   unsigned long i, j = 0;
   for(i = 0; i < ps->nContexts; ++i)
   {
-    Region tmp = 0;
-    Region screen = 0;
-    Region intersection = 0;
+    PrivRegion tmp;
+    PrivRegion intersection;
     /* draw the texture over the whole monitor to affect wobbly windows */
-    XRectangle * r = &ps->contexts[i].xRect;
-    oyRectangle_s * scissor_box = oyRectangle_NewWith( r->x, s->height - r->y - r->height, r->width, r->height, NULL );
+    XRectangle * r = &ps->draw[i].xRect;
+    GLint scissor_box[4] = { r->x, s->height - r->y - r->height,
+                             r->width, r->height };
     /* honour the previous scissor rectangle */
-    oyRectangle_s * scissor = oyRectangle_NewFrom( scissor_box, NULL );
     GLint box[4] = {-1,-1,-1,-1};
     glGetIntegerv( GL_SCISSOR_BOX, &box[0] );
-    oyRectangle_s * global_box = oyRectangle_NewWith( box[0], box[1], box[2], box[3], NULL );
-    oyRectangle_Trim( scissor, global_box );
     if(oy_debug)
     {
-      char * gb = strdup( oyRectangle_Show( global_box ) ),
-           * sb = strdup( oyRectangle_Show( scissor_box ) );
-      if(!oyRectangle_IsEqual( scissor_box, scissor ))
-        printf("%lu GL_SCISSOR_BOX: %s scissor: %s trimmed: %s\n",
-               i, gb, sb, oyRectangle_Show( scissor ));
-      free(gb); free(sb);
+      GLint x0 = scissor_box[0] > box[0] ? scissor_box[0] : box[0],
+            y0 = scissor_box[1] > box[1] ? scissor_box[1] : box[1],
+            x1 = scissor_box[0] + scissor_box[2] < box[0] + box[2] ?
+                 scissor_box[0] + scissor_box[2] : box[0] + box[2],
+            y1 = scissor_box[1] + scissor_box[3] < box[1] + box[3] ?
+                 scissor_box[1] + scissor_box[3] : box[1] + box[3];
+      if(x0 != scissor_box[0] || y0 != scissor_box[1] ||
+         x1 - x0 != scissor_box[2] || y1 - y0 != scissor_box[3])
+        printf("%lu GL_SCISSOR_BOX: %d,%d,%dx%d scissor: %d,%d,%dx%d trimmed: %d,%d,%dx%d\n",
+               i, box[0], box[1], box[2], box[3],
+               scissor_box[0], scissor_box[1], scissor_box[2], scissor_box[3],
+               x0, y0, x1 - x0, y1 - y0 );
     }
-    oyRectangle_Release( &global_box );
     if(ps->nContexts > 1)
-      glScissor( oyRectangle_GetGeo1(scissor_box, 0),
-                 oyRectangle_GetGeo1(scissor_box, 1),
-                 oyRectangle_GetGeo1(scissor_box, 2),
-                 oyRectangle_GetGeo1(scissor_box, 3) );
-    oyRectangle_Release( &scissor_box );
-    oyRectangle_Release( &scissor );
+      glScissor( scissor_box[0], scissor_box[1],
+                 scissor_box[2], scissor_box[3] );
+
+    regionInit( &tmp );
+    regionInit( &intersection );
 
     if(WINDOW_INVISIBLE(w))
       goto cleanDrawTexture;
@@ -1969,80 +5024,64 @@ static void pluginDrawWindowTexture(CompWindow *w, CompTexture *texture, const F
     {
       /* get the window region to find zero sized ones */
       PrivColorRegion * window_region = pw->pRegion + j;
-      tmp = absoluteRegion( w, window_region->xRegion);
-      screen = XCreateRegion();
-      XUnionRectWithRegion( &ps->contexts[i].xRect, screen, screen );    
-      intersection = XCreateRegion();
+      absoluteRegion( w, &window_region->region, &tmp );
 
       /* create intersection of window and monitor */
-      XIntersectRegion( screen, tmp, intersection );
+      regionIntersectRect( &intersection, &tmp, &ps->draw[i].xRect );
 
       /* Only draw where the stencil value matches the window and output */
       glStencilFunc(GL_EQUAL, STENCIL_ID, ~0);
 
-      PrivColorContext * c = NULL;
-      if(window_region->cc)
-        c = window_region->cc[i];
+      PrivColorTexture * tex = NULL;
+      if(window_region->cc && i < window_region->nCc && window_region->cc[i])
+        tex = window_region->cc[i]->texture;
 
       /* set last region, which is the window region, to default colour table */
       if(j == pw->nRegions - 1)
       {
-        c = &ps->contexts[i].cc;
-        if(!c)
-          oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
-                    DBG_STRING "No CLUT found for screen %d / %d / %lu",
-                    DBG_ARGS, screen, ps->nContexts, j );
-
-        /* test for stencil capabilities to place region ID */
-        GLint stencilBits = 0;
-        glGetIntegerv(GL_STENCIL_BITS, &stencilBits);
-        if(stencilBits == 0 && pw->nRegions > 1)
-          c = NULL;
+        tex = &ps->draw[i].texture;
+
+        /* without stencil no region ID can be placed */
+        if(ps->stencilBits == 0 && pw->nRegions > 1)
+          tex = NULL;
       }
 
-      BOX * b = &intersection->extents;
+      BOX * b = &intersection.extents;
 
       if(oy_debug >= 3 && pw->nRegions != 1)
         fprintf( stderr, DBG_STRING"STENCIL_ID = %lu (1 + colour_desktop_region_count=%lu * i=%lu + pw->stencil_id_start=%lu + j=%lu) pw->nRegions=%lu glTexture=%u\t%d,%d,%dx%d\n", DBG_ARGS,
                STENCIL_ID,colour_desktop_region_count,i,pw->stencil_id_start,j,
-               pw->nRegions, c?c->glTexture:0, b->x1, b->y1, b->x2-b->x1, b->y2-b->y1 );
+               pw->nRegions, tex?tex->glTexture:0, b->x1, b->y1, b->x2-b->x1, b->y2-b->y1 );
 
-      if(!c ||
+      if(!tex ||
          (b->x1 == 0 && b->x2 == 0 && b->y1 == 0 && b->y2 == 0))
         goto cleanDrawTexture;
 
-      if(0 && oy_debug)
-        fprintf( stderr, DBG_STRING"i=%lu j=%lu glTexture=%d\t%s -> %s %s \t%d,%d,%dx%d\n", DBG_ARGS,
-               i, j, c->glTexture,
-               oyProfile_GetFileName( c->src_profile, -1 ),
-               oyProfile_GetText( c->dst_profile, oyNAME_DESCRIPTION ),
-               c->output_name, b->x1, b->y1, b->x2-b->x1, b->y2-b->y1 );
-
       /* Set the environment variables */
       glProgramEnvParameter4dARB( GL_FRAGMENT_PROGRAM_ARB, param + 0,
-                                c->scale, c->scale, c->scale, 1.0);
+                                tex->scale, tex->scale, tex->scale, 1.0);
       glProgramEnvParameter4dARB( GL_FRAGMENT_PROGRAM_ARB, param + 1,
-                                c->offset, c->offset, c->offset, 0.0);
+                                tex->offset, tex->offset, tex->offset, 0.0);
 
-      if(c->glTexture)
+      if(tex->glTexture)
       {
         /* Activate the 3D texture */
         (*s->activeTexture) (GL_TEXTURE0_ARB + unit);
         glEnable(GL_TEXTURE_3D);
-        glBindTexture(GL_TEXTURE_3D, c->glTexture);
+        glBindTexture(GL_TEXTURE_3D, tex->glTexture);
         (*s->activeTexture) (GL_TEXTURE0_ARB);
       }
 
       /* Now draw the window texture */
       UNWRAP(ps, s, drawWindowTexture);
-      if(c->glTexture)
+      if(tex->glTexture)
         (*s->drawWindowTexture) (w, texture, &fa, mask);
       else
         /* ignore the shader */
         (*s->drawWindowTexture) (w, texture, attrib, mask);
       WRAP(ps, s, drawWindowTexture, pluginDrawWindowTexture);
 
-      if(c->glTexture)
+      if(tex->glTexture)
       {
         /* Deactivate the 3D texture */
         (*s->activeTexture) (GL_TEXTURE0_ARB + unit);
@@ -2052,12 +5091,8 @@ static void pluginDrawWindowTexture(CompWindow *w, CompTexture *texture, const F
       }
 
       cleanDrawTexture:
-      if(intersection)
-        XDestroyRegion( intersection );
-      if(tmp)
-        XDestroyRegion( tmp );
-      if(screen)
-        XDestroyRegion( screen );
+      regionFini( &intersection );
+      regionFini( &tmp );
     }
     if(ps->nContexts > 1)
       glScissor( box[0], box[1], box[2], box[3] );
@@ -2087,8 +5122,7 @@ static CompBool pluginInitCore(CompPlugin *plugin OY_UNUSED, CompObject *object
     sleep(1);
 #endif
 
-  /* select profiles matching actual capabilities */
-  icc_profile_flags = oyICCProfileSelectionFlagsFromOptions( OY_CMM_STD, "//" OY_TYPE_STD "/icc_color", NULL, 0 );
+  /* Oyranos is initialised in a worker started by warmUpOyranos() */
 
   return TRUE;
 }
@@ -2127,14 +5161,14 @@ static int updateIccColorDesktopAtom ( CompScreen        * s,
 {
   CompDisplay * d = s->display;
   PrivDisplay * pd = compObjectGetPrivate((CompObject *) d);
-  time_t  cutime;         /* Time since epoch */
-  cutime = time(NULL);    /* current user time */
+  Window owner = None;
   const char * my_id = "compicc",
              * my_capabilities = "|ICM|ICP|ICR|ICA|V0.3|"; /* _ICC_COLOR_REGIONS
                                                     * _ICC_COLOR_PROFILES */
   unsigned long n = 0;
   char * data = 0;
-  const char * old_atom = 0;
+  const char * old_atom = 0,
+             * current = 0;
   int status = 0;
  
 
@@ -2167,12 +5201,17 @@ static int updateIccColorDesktopAtom ( CompScreen        * s,
     sscanf( (const char*)data, "%d %ld %s %s",
             &old_pid, &atom_time,
             atom_capabilities_text, atom_colour_server_name );
-    old_atom = data;
+    old_atom = current = data;
   }
 
+  /* the atom time is fixed at the service start; the manager selection
+   * tells, who runs the colour service now */
+  if(ps->colorDesktopSelection)
+    owner = XGetSelectionOwner( d->display, ps->colorDesktopSelection );
+
   if(n && data && old_pid != (int)pid)
   {
-    if(old_atom && atom_time + 60 < cutime)
+    if(old_atom && owner == None)
       oyCompLogMessage( d, "compicc", CompLogLevelWarn,
                     DBG_STRING "\n!!! Found old _ICC_COLOR_DESKTOP pid: %s.\n"
                     "Eigther there was a previous crash or your setup can be double colour corrected.",
@@ -2180,7 +5219,7 @@ static int updateIccColorDesktopAtom ( CompScreen        * s,
     /* check for taking over of colour service */
     if(atom_colour_server_name && strcmp(atom_colour_server_name, my_id) != 0)
     {
-      if( atom_time < icc_color_desktop_last_time ||
+      if( (owner != None && owner == ps->selectionWindow) ||
           /* check for the only other known color server; it can only run for KWin */
           ( atom_colour_server_name &&
             strcmp(atom_colour_server_name, "kolorserver") == 0 ) ||
@@ -2190,11 +5229,14 @@ static int updateIccColorDesktopAtom ( CompScreen        * s,
                     DBG_STRING "\nTaking over colour service from old _ICC_COLOR_DESKTOP: %s.",
                     DBG_ARGS, old_atom ? old_atom : "????" );
 
-        fetchProperty( d->display, RootWindow(d->display,0),
-                        pd->iccColorDesktop, XA_STRING, &n, True);
+        void * old = fetchProperty( d->display, RootWindow(d->display,0),
+                                    pd->iccColorDesktop, XA_STRING, &n, True);
+        if(old)
+          XFree( old );
+        current = 0;
 
       } else
-      if(atom_time > icc_color_desktop_last_time)
+      if(owner != None)
       {
         oyCompLogMessage( d, "compicc", CompLogLevelWarn,
                     DBG_STRING "\nGiving colour service to _ICC_COLOR_DESKTOP: %s.",
@@ -2218,24 +5260,23 @@ static int updateIccColorDesktopAtom ( CompScreen        * s,
 
   int transform_n = 0;
   for(unsigned long i = 0; i < ps->nContexts; ++i)
-    transform_n += ps->contexts[i].cc.glTexture ? 1:0;
+    transform_n += ps->draw[i].texture.glTexture ? 1:0;
 
-  /* test for stencil capabilities to place region ID */
-  GLint stencilBits = 0;
-  glGetIntegerv(GL_STENCIL_BITS, &stencilBits);
-
-  if( (atom_time + 10) < icc_color_desktop_last_time ||
-      request == 2 )
+  if(colour_desktop_can)
   {
     char * atom_text = (char*)cicc_alloc(1024);
     if(!atom_text) goto clean_updateIccColorDesktopAtom;
+    /* the time stays at the service start, so the text changes only with
+     * the capabilities and rewrites can be detected */
     sprintf( atom_text, "%d %ld %s %s",
-             (int)pid, (long)cutime,
+             (int)pid, (long)icc_color_desktop_last_time,
              /* say if we can convert, otherwise give only the version number */
-             transform_n ? (stencilBits?my_capabilities:"|ICM|ICR|ICA|V0.3|"):"|V0.3|",
+             transform_n ? (ps->stencilBits?my_capabilities:"|ICM|ICR|ICA|V0.3|"):"|V0.3|",
              my_id );
  
-   if(attached_profiles || request == 2)
+   if(current && strcmp( current, atom_text ) == 0)
+      ; /* unchanged */
+   else if(attached_profiles || request == 2)
       changeProperty( d->display,
                                 pd->iccColorDesktop, XA_STRING,
                                 (unsigned char*)atom_text,
@@ -2251,34 +5292,130 @@ static int updateIccColorDesktopAtom ( CompScreen        * s,
 
     if(oy_debug)
     {
-      data = fetchProperty( d->display, RootWindow(d->display,0),
-                        pd->iccColorDesktop, XA_STRING, &n, False);
+      char * set = fetchProperty( d->display, RootWindow(d->display,0),
+                                  pd->iccColorDesktop, XA_STRING, &n, False);
 
       oyCompLogMessage( d, "compicc", CompLogLevelDebug,
                     DBG_STRING "request=%d Set _ICC_COLOR_DESKTOP: %s.",
-                    DBG_ARGS, request, data ? data : "????" );
+                    DBG_ARGS, request, set ? set : "????" );
+      if(set)
+        XFree( set );
     }
 
     if(atom_text) cicc_free( atom_text );
   }
 
 clean_updateIccColorDesktopAtom:
+  if(data) XFree( data );
   if(atom_colour_server_name) cicc_free(atom_colour_server_name);
   if(atom_capabilities_text) cicc_free(atom_capabilities_text);
 
-  icc_color_desktop_last_time = cutime;
-
   if(colour_desktop_can == 0)
-    for (unsigned long i = 0; i < ps->nContexts; ++i)
-    {
-      if(ps->contexts[i].cc.glTexture)
-        glDeleteTextures( 1, &ps->contexts[i].cc.glTexture );
-      ps->contexts[i].cc.glTexture = 0;
-    }
+    releaseOutputTextures( s, ps );
 
   return status;
 }
 
+/**
+ * Drop the output transforms after giving away the colour service.
+ */
+static void releaseOutputTextures( CompScreen * s, PrivScreen * ps )
+{
+  for (unsigned long i = 0; i < ps->nContexts; ++i)
+  {
+    cancelJob( ps->contexts[i].cc.job );
+    unqueueUpload( ps, &ps->contexts[i].cc );
+    if(ps->draw[i].texture.glTexture)
+      glDeleteTextures( 1, &ps->draw[i].texture.glTexture );
+    ps->draw[i].texture.glTexture = 0;
+  }
+  damageScreen( s );
+}
+
+/**
+ * XIfEvent() predicate: only the PropertyNotify of our own zero length
+ * append is taken out of the queue; compiz gets all other events.
+ */
+static Bool isSelectionTimestamp( Display * dpy OY_UNUSED, XEvent * event,
+                                  XPointer arg )
+{
+  PrivScreen * ps = (PrivScreen *) arg;
+
+  return event->type == PropertyNotify &&
+         event->xproperty.window == ps->selectionWindow &&
+         event->xproperty.atom == ps->colorDesktopSelection;
+}
+
+/**
+ * Own the _ICC_COLOR_DESKTOP_S<screen> manager selection as ICCCM describes
+ * for managers: with a server timestamp and a MANAGER client message.
+ * A previous owner gets a SelectionClear and stops its colour service.
+ * Other colour servers taking over the selection are noticed the same way,
+ * without polling _ICC_COLOR_DESKTOP.
+ *
+ * @return                             - 0  owner
+ *                                     - 1  error
+ */
+static int acquireColorDesktopSelection( CompScreen * s, PrivScreen * ps )
+{
+  Display * dpy = s->display->display;
+  PrivDisplay * pd = compObjectGetPrivate((CompObject *) s->display);
+  XSetWindowAttributes attr;
+  XEvent event;
+  Window owner;
+  Time timestamp;
+
+  if(s->screenNum >= pd->nColorDesktopSelections)
+    return 1;
+  ps->colorDesktopSelection = pd->colorDesktopSelections[s->screenNum];
+
+  attr.override_redirect = True;
+  attr.event_mask = PropertyChangeMask;
+  ps->selectionWindow = XCreateWindow( dpy, s->root, -100, -100, 1, 1, 0,
+                                       CopyFromParent, InputOnly,
+                                       CopyFromParent,
+                                       CWOverrideRedirect | CWEventMask,
+                                       &attr );
+
+  /* a zero length append returns a server timestamp with its PropertyNotify */
+  XChangeProperty( dpy, ps->selectionWindow, ps->colorDesktopSelection,
+                   XA_STRING, 8, PropModeAppend, NULL, 0 );
+  XIfEvent( dpy, &event, isSelectionTimestamp, (XPointer) ps );
+  timestamp = event.xproperty.time;
+
+  owner = XGetSelectionOwner( dpy, ps->colorDesktopSelection );
+  if(owner != None)
+    oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
+                    DBG_STRING "\nTaking over colour service on screen %d from 0x%lx.",
+                    DBG_ARGS, s->screenNum, owner );
+
+  XSetSelectionOwner( dpy, ps->colorDesktopSelection, ps->selectionWindow,
+                      timestamp );
+  if(XGetSelectionOwner( dpy, ps->colorDesktopSelection ) != ps->selectionWindow)
+  {
+    oyCompLogMessage( s->display, "compicc", CompLogLevelWarn,
+                    DBG_STRING "Could not own _ICC_COLOR_DESKTOP_S%d",
+                    DBG_ARGS, s->screenNum );
+    XDestroyWindow( dpy, ps->selectionWindow );
+    ps->selectionWindow = None;
+    return 1;
+  }
+
+  /* announce the new manager to clients */
+  memset( &event, 0, sizeof(event) );
+  event.xclient.type = ClientMessage;
+  event.xclient.window = s->root;
+  event.xclient.message_type = pd->manager;
+  event.xclient.format = 32;
+  event.xclient.data.l[0] = timestamp;
+  event.xclient.data.l[1] = ps->colorDesktopSelection;
+  event.xclient.data.l[2] = ps->selectionWindow;
+  XSendEvent( dpy, s->root, False, StructureNotifyMask, &event );
+
+  icc_color_desktop_last_time = time(NULL);
+  return 0;
+}
+
 static CompBool pluginInitDisplay(CompPlugin *plugin OY_UNUSED, CompObject *object, void *privateData)
 {
   CompDisplay *d = (CompDisplay *) object;
@@ -2289,12 +5426,52 @@ static CompBool pluginInitDisplay(CompPlugin *plugin OY_UNUSED, CompObject *obje
 
   WRAP(pd, d, handleEvent, pluginHandleEvent);
 
-  pd->iccColorProfiles = XInternAtom(d->display, XCM_COLOR_PROFILES, False);
-  pd->iccColorRegions = XInternAtom(d->display, XCM_COLOR_REGIONS, False);
-  pd->iccColorOutputs = XInternAtom(d->display, XCM_COLOR_OUTPUTS, False);
-  pd->iccColorDesktop = XInternAtom(d->display, XCM_COLOR_DESKTOP, False);
-  pd->netDesktopGeometry = XInternAtom(d->display, "_NET_DESKTOP_GEOMETRY", False);
-  pd->iccDisplayAdvanced = XInternAtom(d->display, XCM_COLOUR_DESKTOP_ADVANCED, False);
+  /* intern all atoms in one round trip, the manager selections included */
+  {
+    char * fixed[] = { XCM_COLOR_PROFILES, XCM_COLOR_REGIONS,
+                       XCM_COLOR_OUTPUTS, XCM_COLOR_DESKTOP,
+                       "_NET_DESKTOP_GEOMETRY", XCM_COLOUR_DESKTOP_ADVANCED,
+                       "MANAGER" };
+    int nFixed = sizeof(fixed) / sizeof(fixed[0]),
+        nScreens = ScreenCount( d->display ),
+        n = nFixed + nScreens;
+    char ** names = (char**) cicc_alloc( n * (sizeof(char*) + 32) );
+    char (*text)[32] = names ? (char(*)[32]) (names + n) : NULL;
+    Atom * atoms = (Atom*) cicc_alloc( n * sizeof(Atom) );
+
+    if(!names || !atoms)
+    {
+      if(names) cicc_free( names );
+      if(atoms) cicc_free( atoms );
+      UNWRAP(pd, d, handleEvent);
+      return FALSE;
+    }
+
+    for(int i = 0; i < nFixed; ++i)
+      names[i] = fixed[i];
+    for(int i = 0; i < nScreens; ++i)
+    {
+      names[nFixed + i] = text[i];
+      snprintf( text[i], 32, "_ICC_COLOR_DESKTOP_S%d", i );
+    }
+
+    XInternAtoms( d->display, names, n, False, atoms );
+
+    pd->iccColorProfiles = atoms[0];
+    pd->iccColorRegions = atoms[1];
+    pd->iccColorOutputs = atoms[2];
+    pd->iccColorDesktop = atoms[3];
+    pd->netDesktopGeometry = atoms[4];
+    pd->iccDisplayAdvanced = atoms[5];
+    pd->manager = atoms[6];
+
+    /* keep the selections in the atoms block */
+    memmove( atoms, atoms + nFixed, nScreens * sizeof(Atom) );
+    pd->colorDesktopSelections = atoms;
+    pd->nColorDesktopSelections = nScreens;
+
+    cicc_free( names );
+  }
 
   return TRUE;
 }
@@ -2310,14 +5487,20 @@ static CompBool pluginInitScreen(CompPlugin *plugin OY_UNUSED, CompObject *objec
   fprintf( stderr, DBG_STRING"dev %d contexts %ld \n", DBG_ARGS,
           s->nOutputDev, ps->nContexts );
     
-  GLint stencilBits = 0;
-  glGetIntegerv(GL_STENCIL_BITS, &stencilBits);
-  if (stencilBits == 0)
+  /* test for stencil capabilities to place region ID */
+  ps->stencilBits = 0;
+  glGetIntegerv(GL_STENCIL_BITS, &ps->stencilBits);
+  if (ps->stencilBits == 0)
   {
     fprintf( stderr, DBG_STRING"stencilBits %d -> limited profile support (ICP)\n", DBG_ARGS,
-             stencilBits );
+             ps->stencilBits );
   }
 
+  if(colour_desktop_can)
+    acquireColorDesktopSelection( s, ps );
+
+  WRAP(ps, s, preparePaintScreen, pluginPreparePaintScreen);
+  WRAP(ps, s, donePaintScreen, pluginDonePaintScreen);
   WRAP(ps, s, drawWindow, pluginDrawWindow);
   WRAP(ps, s, drawWindowTexture, pluginDrawWindowTexture);
 
@@ -2337,6 +5520,7 @@ static CompBool pluginInitScreen(CompPlugin *plugin OY_UNUSED, CompObject *objec
 
   /* initialisation is done in pluginHandleEvent() by checking ps->nContexts */
   ps->nContexts = 0;
+  ps->setupStep = SETUP_IDLE;
 
   return TRUE;
 }
@@ -2367,6 +5551,22 @@ static dispatchObjectProc dispatchInitObject[] = {
 
 static CompBool pluginFiniCore(CompPlugin *plugin OY_UNUSED, CompObject *object OY_UNUSED, void *privateData OY_UNUSED)
 {
+  stopWorkers();
+
+  for(int i = 0; i < OY_DB_FILES; ++i)
+  {
+    if(oy_db_files[i].path)
+      free( oy_db_files[i].path );
+    oy_db_files[i].path = NULL;
+    oy_db_files[i].exists = 0;
+  }
+  oy_db_files_n = 0;
+
+  saveResolvedProfiles();
+  for(int i = 0; i < resolved_profiles_n; ++i)
+    free( resolved_profiles[i].path );
+  resolved_profiles_n = resolved_profiles_loaded = 0;
+
   return TRUE;
 }
 
@@ -2377,6 +5577,16 @@ static CompBool pluginFiniDisplay(CompPlugin *plugin OY_UNUSED, CompObject *obje
 
   UNWRAP(pd, d, handleEvent);
 
+  if(pd->profileBuffer.data)
+    cicc_free( pd->profileBuffer.data );
+  pd->profileBuffer.data = NULL;
+  pd->profileBuffer.reserved = pd->profileBuffer.size = 0;
+
+  if(pd->colorDesktopSelections)
+    cicc_free( pd->colorDesktopSelections );
+  pd->colorDesktopSelections = NULL;
+  pd->nColorDesktopSelections = 0;
+
   return TRUE;
 }
 
@@ -2384,49 +5594,88 @@ static CompBool pluginFiniScreen(CompPlugin *plugin OY_UNUSED, CompObject *objec
 {
   CompScreen *s = (CompScreen *) object;
   PrivScreen *ps = privateData;
+  PrivDisplay *pd = compObjectGetPrivate((CompObject *) s->display);
 
-  int error = 0,
-      init = 0;
-  oyConfigs_s * devices = 0;
-  oyConfig_s * device = 0;
-  Atom iccColorDesktop = XInternAtom(s->display->display, XCM_COLOR_DESKTOP, False);
+  int init = 0;
 
-  /* remove desktop colour management service mark */
-  changeProperty( s->display->display,
-                                iccColorDesktop, XA_STRING,
+  /* remove desktop colour management service mark, if still ours */
+  if(ps->selectionWindow &&
+     XGetSelectionOwner( s->display->display, ps->colorDesktopSelection ) ==
+     ps->selectionWindow)
+    changeProperty( s->display->display,
+                                pd->iccColorDesktop, XA_STRING,
                                 (unsigned char*)NULL, 0 );
+  if(ps->selectionWindow)
+    XDestroyWindow( s->display->display, ps->selectionWindow );
+  ps->selectionWindow = None;
   XFlush( s->display->display );
 
-  error = oyDevicesGet( OY_TYPE_STD, "monitor", 0, &devices );
-  if(error > 0)
-          oyCompLogMessage( NULL, "compicc", CompLogLevelWarn,
-                      DBG_STRING "oyDevicesGet() error: %d",
-                      DBG_ARGS, error);
-
-  /* switch profile atoms back */
+  /* the workers give the contexts back */
   for(unsigned long i = 0; i < ps->nContexts; ++i)
-  {
-    device = oyConfigs_Get( devices, i );
-
-    if(ps->contexts[i].cc.dst_profile)
-      moveICCprofileAtoms( s, i, init );
+    cancelJob( ps->contexts[i].cc.job );
 
-    oyConfig_Release( &device );
+  /* switch profile atoms back; no device enumeration is needed for that */
+  {
+    int * moves = ps->nContexts ? cicc_alloc( ps->nContexts * sizeof(int) ) : NULL,
+        nMoves = 0;
+    for(unsigned long i = 0; moves && i < ps->nContexts; ++i)
+      if(ps->contexts[i].cc.dst_profile)
+        moves[nMoves++] = i;
+    moveICCprofileAtoms( s, moves, nMoves, init );
+    if(moves)
+      cicc_free( moves );
   }
-  oyConfigs_Release( &devices );
 
 
+  rateLimitCancel( &ps->profilesLimit );
+  cancelOutputSetup( ps );
+  cancelJob( ps->warmUp );
+  ps->warmUp = NULL;
+
   /* clean memory */
   freeOutput(ps);
-
+  freeOutputContexts( ps, ps->oldContexts, ps->oldDraw, ps->nOldContexts );
+  ps->oldContexts = NULL;
+  ps->oldDraw = NULL;
+  ps->nOldContexts = 0;
+
+  if(ps->uploads)
+    cicc_free( ps->uploads );
+  ps->uploads = NULL;
+  ps->nUploads = ps->reservedUploads = 0;
+
+  UNWRAP(ps, s, preparePaintScreen);
+  UNWRAP(ps, s, donePaintScreen);
   UNWRAP(ps, s, drawWindow);
   UNWRAP(ps, s, drawWindowTexture);
 
   return TRUE;
 }
 
-static CompBool pluginFiniWindow(CompPlugin *plugin OY_UNUSED, CompObject *object OY_UNUSED, void *privateData OY_UNUSED)
+static CompBool pluginFiniWindow(CompPlugin *plugin OY_UNUSED, CompObject *object, void *privateData)
 {
+  CompWindow *w = (CompWindow *) object;
+  PrivWindow *pw = privateData;
+  PrivScreen *ps = compObjectGetPrivate((CompObject *) w->screen);
+
+  rateLimitCancel( &pw->regionsLimit );
+
+  /* cancels the region jobs and takes their contexts out of the uploads */
+  for(unsigned long k = 0; k < pw->nRegions; ++k)
+  {
+    freeRegionContexts( ps, &pw->pRegion[k] );
+    regionFini( &pw->pRegion[k].region );
+  }
+  if(pw->pRegion)
+    cicc_free( pw->pRegion );
+  pw->pRegion = NULL;
+  pw->nRegions = 0;
+
+  oyRectangle_Release( &pw->absoluteWindowRectangleOld );
+  if(pw->output)
+    XFree( pw->output );
+  pw->output = NULL;
+
   return TRUE;
 }
 
@@ -2440,19 +5689,15 @@ static dispatchObjectProc dispatchFiniObject[] = {
  */
 static CompBool pluginInit(CompPlugin *p OY_UNUSED)
 {
+  compositor_thread = pthread_self();
+
   const char * od = getenv("OY_DEBUG");
   if(od && od[0]) oy_debug = atoi(od);
   oyMessageFunc_p( oyMSG_DBG, NULL, DBG_STRING, DBG_ARGS );
+  cacheInit();
   return TRUE;
 }
 
-static oyStructList_s * privates_cache = 0;
-static oyStructList_s * pluginGetPrivatesCache ()
-{
-  if(!privates_cache)
-    privates_cache = oyStructList_New( 0 );
-  return privates_cache;
-}
 
 
 oyPointer pluginAllocatePrivatePointer( CompObject * o )
@@ -2575,7 +5820,7 @@ static void pluginFiniObject(CompPlugin *p, CompObject *o)
 
 static void pluginFini(CompPlugin *p OY_UNUSED)
 {
-  oyStructList_Release( &privates_cache );
+  cacheFini();
 }
 
 static CompMetadata *pluginGetMetadata(CompPlugin *p OY_UNUSED)